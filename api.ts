@@ -2,7 +2,7 @@ import fastify, { FastifySchema } from 'fastify'
 import fastifyCors from 'fastify-cors'
 import fastifySwagger from 'fastify-swagger'
 
-import Engine, { AccentPhrase, AudioQuery } from '@/index'
+import Engine, { AccentPhrase, AudioQuery, OutputFormat } from '@/index'
 import packageJson from '@/package.json'
 
 const server = fastify({
@@ -27,9 +27,19 @@ void server.register(fastifyCors, {
 })
 
 const PORT = process.env.PORT || 50021
-const engine = new Engine('core.dll', false)
+// CORE_PATHで、スタンドインのコアライブラリなどに差し替えられる
+const engine = new Engine(process.env.CORE_PATH || 'core.dll', false)
 console.log('loading core was succeed')
 
+// 受け付けてから応答を返すまでのリクエストの数。Engineの処理を待っている分も含む
+let httpRequestsInFlight = 0
+server.addHook('onRequest', async () => {
+  httpRequestsInFlight++
+})
+server.addHook('onResponse', async () => {
+  httpRequestsInFlight--
+})
+
 interface AudioQueryApiQuery {
   text: string
   speaker: number
@@ -48,6 +58,10 @@ interface MoraApiQuery {
 interface SynthesisApiQuery {
   speaker: number
   enable_interrogative_upspeak?: boolean
+  format?: OutputFormat
+  direct_silence?: boolean
+  trim_silence?: boolean
+  normalize_loudness?: number
 }
 
 interface RequestContent<Q, B = unknown> {
@@ -155,6 +169,14 @@ const MoraApiSchema: FastifySchema = {
   },
 }
 
+function synthesisContentType(format: OutputFormat): string {
+  if (format === 'flac') return 'audio/flac'
+  if (format === 'mulaw') return 'audio/PCMU'
+  if (format === 'alaw') return 'audio/PCMA'
+  if (format.startsWith('wav')) return 'audio/wav'
+  return 'application/octet-stream'
+}
+
 const SynthesisApiSchema: FastifySchema = {
   body: AudioQuerySchema,
   querystring: {
@@ -163,6 +185,23 @@ const SynthesisApiSchema: FastifySchema = {
     properties: {
       speaker: { type: 'number' },
       enable_interrogative_upspeak: { type: 'boolean' },
+      format: {
+        type: 'string',
+        enum: [
+          'wav',
+          'wav_int24',
+          'wav_float32',
+          'raw_int16',
+          'raw_int24',
+          'raw_float32',
+          'flac',
+          'mulaw',
+          'alaw',
+        ],
+      },
+      direct_silence: { type: 'boolean' },
+      trim_silence: { type: 'boolean' },
+      normalize_loudness: { type: 'number' },
     },
   },
 }
@@ -260,6 +299,16 @@ server.post<RequestContent<MoraApiQuery, AccentPhrase[]>>(
   }
 )
 
+server.get('/metrics', async (request, reply) => {
+  void reply.type('text/plain; version=0.0.4').code(200)
+  return (
+    engine.metrics() +
+    '# HELP voicevox_engine_http_requests_in_flight Unanswered HTTP requests.\n' +
+    '# TYPE voicevox_engine_http_requests_in_flight gauge\n' +
+    `voicevox_engine_http_requests_in_flight ${httpRequestsInFlight}\n`
+  )
+})
+
 server.get('/version', async (request, reply) => {
   return packageJson.version
 })
@@ -276,12 +325,19 @@ server.post<RequestContent<SynthesisApiQuery, AudioQuery>>(
   },
   async (request, reply) => {
     try {
+      const format = request.query.format ?? 'wav'
       const result = engine.synthesis(
         request.body,
         request.query.speaker,
-        request.query.enable_interrogative_upspeak
+        request.query.enable_interrogative_upspeak,
+        {
+          format,
+          directSilence: request.query.direct_silence,
+          trimSilence: request.query.trim_silence,
+          normalizeLoudness: request.query.normalize_loudness,
+        }
       )
-      void reply.type('audio/wav').code(200)
+      void reply.type(synthesisContentType(format)).code(200)
       return result
     } catch (e) {
       void reply.type('application/json').code(400)
@@ -0,0 +1,275 @@
+// 決まった文章をaudio_queryとsynthesisに通し、チェックインした期待値と比べる
+// アクセント句は完全一致、波形は許容誤差の範囲で比べ、食い違った位置を表示する
+// 使い方は README の「出力の回帰テスト」を参照
+import * as fs from 'fs'
+import * as path from 'path'
+
+import Engine, { AccentPhrase, AudioQuery, SynthesisOptions } from '@/index'
+
+interface GoldenCase {
+  name: string
+  text: string
+  speaker: number
+  is_kana?: boolean
+  enable_interrogative_upspeak?: boolean
+  /** audio_queryの結果に上書きする値 */
+  query?: Partial<AudioQuery>
+  options?: SynthesisOptions
+}
+
+interface GoldenQuery {
+  accent_phrases: AccentPhrase[]
+  kana: string
+}
+
+interface GoldenOptions {
+  core: string
+  golden: string
+  tolerance: number
+  update: boolean
+  only?: string
+}
+
+// ユーザー辞書の単語で結果が変わらないよう、空の名前空間を使う
+const DICT_NAMESPACE = 'golden_regression'
+// 食い違いを表示する最大の数(1ケースあたり)
+const MAX_REPORTED = 10
+// 音素とf0を間引く位置を固定し、合成のたびに波形が変わらないようにする
+const RESAMPLE_OFFSET = '0.5'
+
+function defaultCorePath(): string {
+  if (process.platform === 'win32') return 'build/Release/stand_in_core.dll'
+  if (process.platform === 'darwin') {
+    return 'build/Release/libstand_in_core.dylib'
+  }
+  return 'build/Release/libstand_in_core.so'
+}
+
+function parseOptions(argv: string[]): GoldenOptions {
+  const args = new Map<string, string>()
+  let update = false
+  for (let i = 0; i < argv.length; i++) {
+    if (argv[i] === '--update') {
+      update = true
+    } else if (argv[i].startsWith('--')) {
+      args.set(argv[i].slice(2), argv[i + 1] ?? '')
+      i++
+    }
+  }
+  return {
+    core: args.get('core') ?? defaultCorePath(),
+    golden: args.get('golden') ?? path.join(__dirname, 'golden'),
+    tolerance: Number(args.get('tolerance') ?? 1e-4),
+    update,
+    only: args.get('only'),
+  }
+}
+
+function createQuery(engine: Engine, golden_case: GoldenCase): AudioQuery {
+  let query: AudioQuery
+  if (golden_case.is_kana) {
+    // audio_queryと同じ初期値で、カナからクエリを組み立てる
+    query = {
+      accent_phrases: engine.accent_phrases(
+        golden_case.text,
+        golden_case.speaker,
+        true,
+        DICT_NAMESPACE
+      ),
+      speedScale: 1,
+      pitchScale: 0,
+      intonationScale: 1,
+      volumeScale: 1,
+      prePhonemeLength: 0.1,
+      postPhonemeLength: 0.1,
+      outputSamplingRate: 24000,
+      outputStereo: false,
+      kana: golden_case.text,
+    }
+  } else {
+    query = engine.audio_query(
+      golden_case.text,
+      golden_case.speaker,
+      DICT_NAMESPACE
+    )
+  }
+  return { ...query, ...golden_case.query }
+}
+
+// 最初に食い違った値から順に、JSONの位置と値を集める
+function diffJson(
+  expected: unknown,
+  actual: unknown,
+  location: string,
+  diffs: string[]
+): void {
+  if (diffs.length >= MAX_REPORTED) return
+  if (
+    typeof expected === 'object' &&
+    expected !== null &&
+    typeof actual === 'object' &&
+    actual !== null &&
+    Array.isArray(expected) === Array.isArray(actual)
+  ) {
+    const expected_record = expected as Record<string, unknown>
+    const actual_record = actual as Record<string, unknown>
+    const keys = Object.keys(expected_record)
+    for (const key of Object.keys(actual_record)) {
+      if (keys.indexOf(key) < 0) keys.push(key)
+    }
+    for (const key of keys) {
+      const child = Array.isArray(expected)
+        ? `${location}[${key}]`
+        : `${location}.${key}`
+      diffJson(expected_record[key], actual_record[key], child, diffs)
+    }
+    return
+  }
+  if (expected !== actual) {
+    diffs.push(
+      `${location}: expected ${JSON.stringify(expected)}, ` +
+        `actual ${JSON.stringify(actual)}`
+    )
+  }
+}
+
+function readSamples(buffer: Buffer): number[] {
+  const samples: number[] = []
+  for (let i = 0; i + 4 <= buffer.length; i += 4) {
+    samples.push(buffer.readFloatLE(i))
+  }
+  return samples
+}
+
+// 許容誤差を超えたサンプルを、チャンネルあたりの位置と秒で示す
+function diffWave(
+  expected: number[],
+  actual: number[],
+  query: AudioQuery,
+  tolerance: number,
+  diffs: string[]
+): { max_error: number; rms_error: number } {
+  const channels = query.outputStereo ? 2 : 1
+  const sampling_rate = query.outputSamplingRate
+  if (expected.length !== actual.length) {
+    diffs.push(
+      `wave length: expected ${expected.length / channels} samples, ` +
+        `actual ${actual.length / channels} samples`
+    )
+  }
+  const length = Math.min(expected.length, actual.length)
+  let max_error = 0
+  let squared_error = 0
+  let exceeded = 0
+  for (let i = 0; i < length; i++) {
+    const error = Math.abs(expected[i] - actual[i])
+    squared_error += error * error
+    if (error > max_error) max_error = error
+    if (error > tolerance) {
+      if (exceeded < MAX_REPORTED) {
+        const sample = Math.floor(i / channels)
+        diffs.push(
+          `wave[${sample}] (${(sample / sampling_rate).toFixed(4)} s, ` +
+            `channel ${i % channels}): expected ${expected[i]}, ` +
+            `actual ${actual[i]}`
+        )
+      }
+      exceeded++
+    }
+  }
+  if (exceeded > MAX_REPORTED) {
+    diffs.push(`... ${exceeded} samples exceed the tolerance in total`)
+  }
+  return {
+    max_error,
+    rms_error: Math.sqrt(squared_error / Math.max(length, 1)),
+  }
+}
+
+function main() {
+  const options = parseOptions(process.argv.slice(2))
+  const cases = (
+    JSON.parse(
+      fs.readFileSync(path.join(options.golden, 'cases.json'), 'utf-8')
+    ) as GoldenCase[]
+  ).filter(
+    (golden_case) =>
+      options.only === undefined || golden_case.name === options.only
+  )
+  // 最初の合成の前に設定する必要がある
+  process.env.VOICEVOX_RESAMPLE_OFFSET = RESAMPLE_OFFSET
+  const engine = new Engine(options.core, false)
+  engine.create_dict_namespace(DICT_NAMESPACE)
+
+  let failed = 0
+  let missing = 0
+  for (const golden_case of cases) {
+    const query = createQuery(engine, golden_case)
+    const wave = engine.synthesis(
+      query,
+      golden_case.speaker,
+      golden_case.enable_interrogative_upspeak ?? false,
+      { ...golden_case.options, format: 'raw_float32' }
+    )
+    const actual_query: GoldenQuery = {
+      accent_phrases: query.accent_phrases,
+      kana: query.kana,
+    }
+    const query_path = path.join(options.golden, `${golden_case.name}.json`)
+    const wave_path = path.join(options.golden, `${golden_case.name}.f32`)
+
+    if (options.update) {
+      fs.writeFileSync(
+        query_path,
+        JSON.stringify(actual_query, null, 2) + '\n'
+      )
+      fs.writeFileSync(wave_path, wave)
+      console.log(`updated ${golden_case.name}`)
+      continue
+    }
+
+    const diffs: string[] = []
+    let summary = ''
+    if (!fs.existsSync(query_path) || !fs.existsSync(wave_path)) {
+      diffs.push(`golden files not found: ${query_path}, ${wave_path}`)
+      missing++
+    } else {
+      const expected_query = JSON.parse(
+        fs.readFileSync(query_path, 'utf-8')
+      ) as GoldenQuery
+      diffJson(expected_query, actual_query, 'query', diffs)
+      const error = diffWave(
+        readSamples(fs.readFileSync(wave_path)),
+        readSamples(wave),
+        query,
+        options.tolerance,
+        diffs
+      )
+      summary =
+        ` (max error ${error.max_error.toExponential(2)},` +
+        ` rms error ${error.rms_error.toExponential(2)})`
+    }
+    console.log(
+      `${diffs.length === 0 ? 'ok  ' : 'FAIL'} ${golden_case.name}${summary}`
+    )
+    if (diffs.length > 0) {
+      failed++
+      for (const diff of diffs) console.log(`    ${diff}`)
+    }
+  }
+  engine.delete_dict_namespace(DICT_NAMESPACE)
+
+  if (!options.update) {
+    console.log(`${cases.length - failed}/${cases.length} cases passed`)
+    if (missing > 0) {
+      // 期待値がないケースは比べられないので、生成の手順を示す
+      console.log(
+        `${missing} cases have no golden files; ` +
+          'run `yarn bench:golden:update` on a full build and commit them'
+      )
+    }
+  }
+  process.exit(failed > 0 ? 1 : 0)
+}
+
+main()
@@ -0,0 +1,357 @@
+// 複数の合成を同時に流し続け、実時間比(RTF)や遅延、スループットを測る
+// 使い方は README の「負荷試験」を参照
+import * as fs from 'fs'
+import * as http from 'http'
+import { performance } from 'perf_hooks'
+import { isMainThread, parentPort, Worker, workerData } from 'worker_threads'
+
+import Engine, { AudioQuery, OutputFormat } from '@/index'
+
+interface LoadOptions {
+  mode: 'inprocess' | 'http'
+  streams: number
+  duration: number
+  warmup: number
+  texts: string[]
+  speakers: number[]
+  format: OutputFormat
+  core: string
+  url: string
+}
+
+interface RequestResult {
+  /** audio_queryからsynthesisの完了までの時間(ミリ秒) */
+  latency: number
+  /** 最初の音声データを受け取るまでの時間(ミリ秒) */
+  first_audio: number
+  /** 合成した音声の長さ(秒) */
+  audio_duration: number
+  sampling_rate: number
+}
+
+// pipeline_benchと同じ短文・中文・長文
+const DEFAULT_TEXTS = [
+  'こんにちは。',
+  '吾輩は猫である。名前はまだ無い。どこで生れたかとんと見当がつかぬ。',
+  '吾輩は猫である。名前はまだ無い。どこで生れたかとんと見当がつかぬ。' +
+    '何でも薄暗いじめじめした所でニャーニャー泣いていた事だけは記憶している。' +
+    '吾輩はここで始めて人間というものを見た。しかもあとで聞くとそれは書生という人間中で一番獰悪な種族であったそうだ。',
+]
+
+function parseOptions(argv: string[]): LoadOptions {
+  const args = new Map<string, string>()
+  for (let i = 0; i < argv.length; i++) {
+    if (argv[i].startsWith('--')) {
+      args.set(argv[i].slice(2), argv[i + 1] ?? '')
+      i++
+    }
+  }
+  const corpus = args.get('corpus')
+  const texts = corpus
+    ? fs
+        .readFileSync(corpus, 'utf-8')
+        .split(/\r?\n/)
+        .filter((line) => line.trim() !== '')
+    : DEFAULT_TEXTS
+  return {
+    mode: args.get('mode') === 'http' ? 'http' : 'inprocess',
+    streams: Number(args.get('streams') ?? 4),
+    duration: Number(args.get('duration') ?? 30),
+    warmup: Number(args.get('warmup') ?? 1),
+    texts,
+    speakers: (args.get('speakers') ?? '0').split(',').map(Number),
+    format: (args.get('format') ?? 'wav') as OutputFormat,
+    core: args.get('core') ?? 'core.dll',
+    url: args.get('url') ?? 'http://localhost:50021',
+  }
+}
+
+// 前後の無音を含めた、AudioQueryから合成される音声の長さ(秒)
+function audioDuration(query: AudioQuery): number {
+  let length = query.prePhonemeLength + query.postPhonemeLength
+  for (const accent_phrase of query.accent_phrases) {
+    const moras = accent_phrase.pause_mora
+      ? [...accent_phrase.moras, accent_phrase.pause_mora]
+      : accent_phrase.moras
+    for (const mora of moras) {
+      length += (mora.consonant_length ?? 0) + mora.vowel_length
+    }
+  }
+  return length / query.speedScale
+}
+
+function outputSamplingRate(query: AudioQuery, format: OutputFormat): number {
+  return format === 'mulaw' || format === 'alaw'
+    ? 8000
+    : query.outputSamplingRate
+}
+
+function post(
+  url: string,
+  body?: unknown
+): Promise<{ data: Buffer; first_data: number }> {
+  return new Promise((resolve, reject) => {
+    const payload = body === undefined ? '' : JSON.stringify(body)
+    const request = http.request(
+      url,
+      {
+        method: 'POST',
+        headers: {
+          'Content-Type': 'application/json',
+          'Content-Length': Buffer.byteLength(payload),
+        },
+      },
+      (response) => {
+        const chunks: Buffer[] = []
+        let first_data = 0
+        response.on('data', (chunk: Buffer) => {
+          if (chunks.length === 0) first_data = performance.now()
+          chunks.push(chunk)
+        })
+        response.on('end', () => {
+          if (response.statusCode !== 200) {
+            const message = Buffer.concat(chunks).toString()
+            reject(new Error(`${url}: ${response.statusCode ?? ''} ${message}`))
+            return
+          }
+          resolve({ data: Buffer.concat(chunks), first_data })
+        })
+      }
+    )
+    request.on('error', reject)
+    request.end(payload)
+  })
+}
+
+type StreamRequest = (text: string, speaker: number) => Promise<RequestResult>
+
+// 計測を始める前に、ストリームの最初の文を結果に含めずに合成する
+async function warmUp(
+  options: LoadOptions,
+  stream: number,
+  request: StreamRequest
+): Promise<void> {
+  for (let i = 0; i < options.warmup; i++) {
+    const text = options.texts[stream % options.texts.length]
+    const speaker = options.speakers[stream % options.speakers.length]
+    await request(text, speaker)
+  }
+}
+
+// 1つのストリームとして、全ストリームで共通の開始時刻(Date.now())から計測時間が過ぎるまで合成を繰り返す
+async function runStream(
+  options: LoadOptions,
+  stream: number,
+  request: StreamRequest,
+  start: number
+): Promise<RequestResult[]> {
+  const results: RequestResult[] = []
+  const end = start + options.duration * 1000
+  for (let i = stream; Date.now() < end; i += options.streams) {
+    const text = options.texts[i % options.texts.length]
+    const speaker = options.speakers[i % options.speakers.length]
+    results.push(await request(text, speaker))
+  }
+  return results
+}
+
+function httpRequest(options: LoadOptions) {
+  return async (text: string, speaker: number): Promise<RequestResult> => {
+    const start = performance.now()
+    const text_query = encodeURIComponent(text)
+    const query_response = await post(
+      `${options.url}/audio_query?text=${text_query}&speaker=${speaker}`
+    )
+    const query = JSON.parse(query_response.data.toString()) as AudioQuery
+    const synthesis = await post(
+      `${options.url}/synthesis?speaker=${speaker}&format=${options.format}`,
+      query
+    )
+    const end = performance.now()
+    return {
+      latency: end - start,
+      first_audio: synthesis.first_data - start,
+      audio_duration: audioDuration(query),
+      sampling_rate: outputSamplingRate(query, options.format),
+    }
+  }
+}
+
+// ワーカーごとにEngineを作り、ワーカーの中では1つずつ合成する
+function inprocessRequest(options: LoadOptions) {
+  const engine = new Engine(options.core, false)
+  return (text: string, speaker: number): Promise<RequestResult> => {
+    const start = performance.now()
+    const query = engine.audio_query(text, speaker)
+    engine.synthesis(query, speaker, true, { format: options.format })
+    const latency = performance.now() - start
+    return Promise.resolve({
+      // 出力をまとめて返すため、最初の音声は全体の完了と同時になる
+      latency,
+      first_audio: latency,
+      audio_duration: audioDuration(query),
+      sampling_rate: outputSamplingRate(query, options.format),
+    })
+  }
+}
+
+// ワーカーとメインスレッドの間のメッセージ
+type WorkerMessage =
+  | { type: 'ready' }
+  | { type: 'start'; start: number }
+  | { type: 'results'; results: RequestResult[] }
+
+interface StreamWorker {
+  /** Engineの初期化とウォームアップが終わると解決する */
+  ready: Promise<void>
+  /** 開始時刻を送ると計測を始め、結果で解決する */
+  run: (start: number) => Promise<RequestResult[]>
+  terminate: () => Promise<number>
+}
+
+function spawnWorker(options: LoadOptions, stream: number): StreamWorker {
+  // ts-nodeから起動された場合も、ワーカーで同じファイルを読み込めるようにする
+  const register = __filename.endsWith('.ts')
+    ? "require('ts-node/register'); require('tsconfig-paths/register');"
+    : ''
+  const script = `${register} require(${JSON.stringify(__filename)})`
+  const worker = new Worker(script, {
+    eval: true,
+    workerData: { options, stream },
+  })
+  const failed = new Promise<never>((_, reject) => {
+    worker.once('error', reject)
+  })
+  const ready = new Promise<void>((resolve) => {
+    worker.once('message', () => resolve())
+  })
+  return {
+    ready: Promise.race([ready, failed]),
+    run: (start: number) => {
+      const results = new Promise<RequestResult[]>((resolve) => {
+        worker.once('message', (message: WorkerMessage) => {
+          if (message.type === 'results') resolve(message.results)
+        })
+      })
+      worker.postMessage({ type: 'start', start } as WorkerMessage)
+      return Promise.race([results, failed])
+    },
+    terminate: () => worker.terminate(),
+  }
+}
+
+function percentile(sorted: number[], p: number): number {
+  if (sorted.length === 0) return 0
+  return sorted[Math.min(sorted.length - 1, Math.floor(sorted.length * p))]
+}
+
+function summarize(
+  options: LoadOptions,
+  results: RequestResult[],
+  elapsed: number
+) {
+  const latencies = results
+    .map((result) => result.latency)
+    .sort((a, b) => a - b)
+  const first_audios = results
+    .map((result) => result.first_audio)
+    .sort((a, b) => a - b)
+  const rtfs = results
+    .map((result) => result.latency / 1000 / result.audio_duration)
+    .sort((a, b) => a - b)
+  const total_latency = latencies.reduce((sum, latency) => sum + latency, 0)
+  const total_audio = results.reduce(
+    (sum, result) => sum + result.audio_duration,
+    0
+  )
+  const total_samples = results.reduce(
+    (sum, result) => sum + result.audio_duration * result.sampling_rate,
+    0
+  )
+  return {
+    mode: options.mode,
+    streams: options.streams,
+    speakers: options.speakers,
+    format: options.format,
+    texts: options.texts.length,
+    elapsed_s: elapsed,
+    requests: results.length,
+    requests_per_s: results.length / elapsed,
+    latency_ms: {
+      mean: total_latency / Math.max(results.length, 1),
+      p50: percentile(latencies, 0.5),
+      p95: percentile(latencies, 0.95),
+      p99: percentile(latencies, 0.99),
+    },
+    first_audio_ms: {
+      p50: percentile(first_audios, 0.5),
+      p95: percentile(first_audios, 0.95),
+      p99: percentile(first_audios, 0.99),
+    },
+    // 1リクエストの処理時間を音声の長さで割った値。1未満なら実時間より速い
+    rtf: {
+      aggregate: total_latency / 1000 / Math.max(total_audio, 1e-9),
+      p50: percentile(rtfs, 0.5),
+      p95: percentile(rtfs, 0.95),
+      p99: percentile(rtfs, 0.99),
+    },
+    // 全ストリーム合わせて、経過時間1秒あたりに合成した音声
+    audio_s_per_s: total_audio / elapsed,
+    samples_per_s: total_samples / elapsed,
+  }
+}
+
+async function main() {
+  const options = parseOptions(process.argv.slice(2))
+  const streams: number[] = []
+  for (let i = 0; i < options.streams; i++) streams.push(i)
+  // Engineの初期化とウォームアップを計測に含めないよう、全ストリームの準備ができてから時計を動かす
+  let start: number
+  let results: RequestResult[][]
+  if (options.mode === 'http') {
+    const request = httpRequest(options)
+    await Promise.all(
+      streams.map((stream) => warmUp(options, stream, request))
+    )
+    start = performance.now()
+    const start_time = Date.now()
+    results = await Promise.all(
+      streams.map((stream) => runStream(options, stream, request, start_time))
+    )
+  } else {
+    const workers = streams.map((stream) => spawnWorker(options, stream))
+    await Promise.all(workers.map((worker) => worker.ready))
+    start = performance.now()
+    const start_time = Date.now()
+    results = await Promise.all(workers.map((worker) => worker.run(start_time)))
+    // 先に終わったワーカーのEngineの破棄が、他のワーカーの合成と重ならないよう、全員の結果を待ってから終了させる
+    await Promise.all(workers.map((worker) => worker.terminate()))
+  }
+  const elapsed = (performance.now() - start) / 1000
+  const flattened = ([] as RequestResult[]).concat(...results)
+  console.log(JSON.stringify(summarize(options, flattened, elapsed), null, 2))
+}
+
+if (isMainThread) {
+  main().catch((e) => {
+    console.error(e)
+    process.exit(1)
+  })
+} else {
+  const { options, stream } = workerData as {
+    options: LoadOptions
+    stream: number
+  }
+  const request = inprocessRequest(options)
+  // 失敗した場合はワーカーのerrorイベントとして呼び出し元に伝わる
+  warmUp(options, stream, request).then(() => {
+    // 結果を返した後も、メインスレッドに終了させられるまでEngineを保持する
+    parentPort?.on('message', (message: WorkerMessage) => {
+      if (message.type !== 'start') return
+      runStream(options, stream, request, message.start).then((results) =>
+        parentPort?.postMessage({ type: 'results', results } as WorkerMessage)
+      )
+    })
+    parentPort?.postMessage({ type: 'ready' } as WorkerMessage)
+  })
+}
@@ -0,0 +1,85 @@
+// PCM変換と音量の測定、調整のカーネルの実装ごとの速度を比べる
+// node-gyp rebuild --build_benchmarks=true でビルドし、build/Release/pcm_kernel_bench を実行する
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "../engine/pcm_kernel.h"
+
+int main() {
+    // 24kHzで10秒分
+    const size_t size = 24000 * 10;
+    const int iterations = 200;
+
+    std::vector<float> input(size);
+    std::mt19937 engine(0);
+    // クリップも通るように[-1, 1]より少し広くする
+    std::uniform_real_distribution<float> dist(-1.2f, 1.2f);
+    for (float &value : input) value = dist(engine);
+
+    const PcmKernelType types[] = { PCM_KERNEL_SCALAR, PCM_KERNEL_SSE2, PCM_KERNEL_AVX2, PCM_KERNEL_NEON };
+    for (int num_channels = 1; num_channels <= 2; num_channels++) {
+        std::vector<int16_t> expected(size * num_channels);
+        get_pcm_int16_converter(PCM_KERNEL_SCALAR)(input.data(), size, 0.8f, num_channels, expected.data());
+
+        double scalar_ns = 0.0;
+        for (PcmKernelType type : types) {
+            PcmInt16Converter converter = get_pcm_int16_converter(type);
+            if (converter == nullptr) continue;
+
+            std::vector<int16_t> output(size * num_channels);
+            converter(input.data(), size, 0.8f, num_channels, output.data());
+            bool matched = std::memcmp(output.data(), expected.data(), output.size() * sizeof(int16_t)) == 0;
+
+            auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < iterations; i++) {
+                converter(input.data(), size, 0.8f, num_channels, output.data());
+            }
+            auto end = std::chrono::steady_clock::now();
+            double ns = std::chrono::duration<double, std::nano>(end - start).count() / ((double)size * iterations);
+            if (type == PCM_KERNEL_SCALAR) scalar_ns = ns;
+
+            std::printf(
+                "%-6s channels=%d %7.3f ns/sample %6.2fx%s\n",
+                pcm_kernel_type_name(type),
+                num_channels,
+                ns,
+                scalar_ns / ns,
+                matched ? "" : " (MISMATCH)"
+            );
+        }
+    }
+    // 音量の測定(二乗和、ピーク)と調整
+    double scalar_ns = 0.0;
+    for (PcmKernelType type : types) {
+        PcmAnalysisKernel kernel = get_pcm_analysis_kernel(type);
+        if (kernel.sum_of_squares == nullptr) continue;
+
+        std::vector<float> samples(input);
+        double sum = 0.0;
+        float peak = 0.0f;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; i++) {
+            sum += kernel.sum_of_squares(samples.data(), size);
+            peak = kernel.peak(samples.data(), size);
+            kernel.scale(samples.data(), size, 1.0f);
+        }
+        auto end = std::chrono::steady_clock::now();
+        double ns = std::chrono::duration<double, std::nano>(end - start).count() / ((double)size * iterations);
+        if (type == PCM_KERNEL_SCALAR) scalar_ns = ns;
+
+        std::printf(
+            "%-6s analysis  %7.3f ns/sample %6.2fx (sum=%.1f peak=%.3f)\n",
+            pcm_kernel_type_name(type),
+            ns,
+            scalar_ns / ns,
+            sum / iterations,
+            peak
+        );
+    }
+    std::printf("selected: %s\n", pcm_kernel_type_name(best_pcm_kernel_type()));
+    return 0;
+}
@@ -0,0 +1,170 @@
+// 音声合成の各段階を、短文・中文・長文の決まった文章で計測し、結果をJSONで出力する
+// node-gyp rebuild --build_benchmarks=true でビルドし、以下のように実行する
+//   build/Release/pipeline_bench path/to/open_jtalk_dic_utf_8-1.11 [繰り返し回数] > result.json
+// parse_kanaとcreate_kanaはNapi::Envが必要なため、ここでは計測しない
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../engine/acoustic_feature_extractor.h"
+#include "../engine/full_context_label.h"
+#include "../engine/nlohmann/json.hpp"
+#include "../engine/openjtalk.h"
+#include "../engine/user_dict.h"
+#include "../engine/wave_resampler.h"
+#include "../engine/wave_writer.h"
+
+using json = nlohmann::json;
+
+struct CorpusText {
+    const char *name;
+    const char *text;
+};
+
+static const CorpusText corpus[] = {
+    { "short", "こんにちは。" },
+    {
+        "medium",
+        "吾輩は猫である。名前はまだ無い。どこで生れたかとんと見当がつかぬ。"
+    },
+    {
+        "long",
+        "吾輩は猫である。名前はまだ無い。どこで生れたかとんと見当がつかぬ。"
+        "何でも薄暗いじめじめした所でニャーニャー泣いていた事だけは記憶している。"
+        "吾輩はここで始めて人間というものを見た。しかもあとで聞くとそれは書生という人間中で一番獰悪な種族であったそうだ。"
+        "この書生というのは時々我々を捕えて煮て食うという話である。しかしその当時は何という考もなかったから別段恐しいとも思わなかった。"
+        "ただ彼の掌に載せられてスーと持ち上げられた時何だかフワフワした感じがあったばかりである。"
+    },
+};
+
+// 音素1つあたりのフレーム数(200Hzで0.08秒)
+constexpr int FRAMES_PER_PHONEME = 16;
+constexpr int DEFAULT_SAMPLING_RATE = 24000;
+constexpr int FRAME_SIZE = 256;
+
+static json measure(const std::string &stage, const std::string &corpus_name, int iterations, const std::function<void()> &func) {
+    // 初回はキャッシュや辞書の読み込みの影響を受けるので捨てる
+    func();
+    std::vector<double> durations;
+    for (int i = 0; i < iterations; i++) {
+        auto start = std::chrono::steady_clock::now();
+        func();
+        auto end = std::chrono::steady_clock::now();
+        durations.push_back(std::chrono::duration<double, std::micro>(end - start).count());
+    }
+    std::sort(durations.begin(), durations.end());
+    double total = 0.0;
+    for (double duration : durations) total += duration;
+
+    json result;
+    result["stage"] = stage;
+    result["corpus"] = corpus_name;
+    result["iterations"] = iterations;
+    result["mean_us"] = total / iterations;
+    result["min_us"] = durations.front();
+    result["p50_us"] = durations[durations.size() / 2];
+    result["p95_us"] = durations[std::min(durations.size() - 1, durations.size() * 95 / 100)];
+    std::cerr << stage << " " << corpus_name << ": " << result["mean_us"].get<double>() << " us" << std::endl;
+    return result;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        std::cerr << "usage: " << argv[0] << " <open_jtalk_dict_dir> [iterations]" << std::endl;
+        return 1;
+    }
+    std::string dict_dir = argv[1];
+    int iterations = argc >= 3 ? std::max(std::atoi(argv[2]), 1) : 100;
+
+    OpenJTalk openjtalk(dict_dir);
+    json results = json::array();
+
+    for (const CorpusText &text : corpus) {
+        std::vector<std::string> labels = openjtalk.extract_fullcontext(text.text);
+        results.push_back(measure("extract_fullcontext", text.name, iterations, [&]() {
+            openjtalk.extract_fullcontext(text.text);
+        }));
+
+        results.push_back(measure("phoneme_from_label", text.name, iterations, [&]() {
+            for (const std::string &label : labels) delete Phoneme::from_label(label);
+        }));
+
+        std::vector<Phoneme *> phonemes;
+        for (const std::string &label : labels) phonemes.push_back(Phoneme::from_label(label));
+        // Utteranceは構築したノードを解放しないため、計測の間は解放せずに続ける
+        results.push_back(measure("utterance_from_phonemes", text.name, iterations, [&]() {
+            Utterance::from_phonemes(phonemes);
+        }));
+
+        std::vector<std::string> phoneme_str_list;
+        for (Phoneme *phoneme : Utterance::from_phonemes(phonemes).phonemes()) {
+            phoneme_str_list.push_back(phoneme->phoneme());
+        }
+        std::vector<OjtPhoneme> phoneme_data_list = to_phoneme_data_list(phoneme_str_list);
+        results.push_back(measure("split_mora", text.name, iterations, [&]() {
+            std::vector<OjtPhoneme> consonant_phoneme_list;
+            std::vector<OjtPhoneme> vowel_phoneme_list;
+            std::vector<long> vowel_indexes;
+            split_mora(phoneme_data_list, consonant_phoneme_list, vowel_phoneme_list, vowel_indexes);
+        }));
+
+        // 音素ごとに同じ長さのフレームを並べ、synthesisと同じく200Hzから復号のフレームレートに変換する
+        size_t num_frames = phoneme_data_list.size() * FRAMES_PER_PHONEME;
+        std::vector<float> f0(num_frames, 0.0f);
+        std::vector<std::vector<float>> phoneme(num_frames, std::vector<float>(OjtPhoneme::num_phoneme(), 0.0f));
+        for (size_t i = 0; i < num_frames; i++) {
+            f0[i] = 5.5f + 0.1f * std::sin((float)i * 0.05f);
+            long phoneme_id = phoneme_data_list[i / FRAMES_PER_PHONEME].phoneme_id();
+            if (phoneme_id >= 0) phoneme[i][phoneme_id] = 1.0f;
+        }
+        size_t num_decoded_frames = 0;
+        results.push_back(measure("resample_frames", text.name, iterations, [&]() {
+            std::vector<int> indexes = resample_indexes(num_frames, 200, (float)DEFAULT_SAMPLING_RATE / FRAME_SIZE);
+            std::vector<float> resampled_f0 = resample(f0, indexes);
+            std::vector<float> resampled_phoneme = resample(phoneme, indexes);
+            num_decoded_frames = resampled_f0.size();
+        }));
+
+        std::vector<float> wave(num_decoded_frames * FRAME_SIZE);
+        for (size_t i = 0; i < wave.size(); i++) {
+            wave[i] = 0.3f * std::sin(2.0f * 3.14159265f * 220.0f * (float)i / DEFAULT_SAMPLING_RATE);
+        }
+        results.push_back(measure("resample_wave_44100", text.name, iterations, [&]() {
+            WaveResampler::resample(wave, DEFAULT_SAMPLING_RATE, 44100);
+        }));
+
+        const WaveFormat formats[] = { WAVE_FORMAT_WAV_INT16, WAVE_FORMAT_FLAC };
+        for (WaveFormat format : formats) {
+            WaveWriter writer(format, 1, DEFAULT_SAMPLING_RATE);
+            results.push_back(measure(std::string("write_") + wave_format_name(format), text.name, iterations, [&]() {
+                writer.write(wave, 1.0f);
+            }));
+        }
+    }
+
+    // ユーザー辞書のコンパイルは単語数ごとに計測する。時間がかかるので繰り返しは少なくする
+    const size_t word_counts[] = { 10, 1000 };
+    for (size_t word_count : word_counts) {
+        std::vector<std::string> csv_rows;
+        for (size_t i = 0; i < word_count; i++) {
+            csv_rows.push_back(word_to_csv_row(create_word("ベンチ" + std::to_string(i), "ベンチマーク", 1)));
+        }
+        std::string out_path = "pipeline_bench_user.dic";
+        results.push_back(measure("compile_user_dict", std::to_string(word_count) + "_words", std::max(iterations / 10, 1), [&]() {
+            std::remove(compile_user_dict(dict_dir, csv_rows, out_path).c_str());
+        }));
+    }
+
+    json output;
+    output["iterations"] = iterations;
+    output["results"] = results;
+    std::cout << output.dump(2) << std::endl;
+    return 0;
+}
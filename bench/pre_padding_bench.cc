@@ -0,0 +1,101 @@
+// 先頭の余白を校正した場合に、復号するフレーム数と時間がどれだけ減るかを測る
+// node-gyp rebuild --build_benchmarks=true でビルドし、コアライブラリのパスと話者IDを渡して実行する
+// ./build/Release/pre_padding_bench path/to/libcore.so 0 1
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+#include <vector>
+
+#include "../core/core.h"
+#include "../engine/acoustic_feature_extractor.h"
+#include "../engine/pre_padding.h"
+
+// decode_forwardの1フレームは256サンプル(24kHz)
+constexpr double FRAME_RATE = 24000.0 / 256.0;
+
+static int padding_frames(float length) {
+    return (int)std::round(length * FRAME_RATE);
+}
+
+// 余白と、prompt_frames分の母音を復号する時間(ミリ秒)
+static double decode_ms(Core &core, long speaker_id, int pad_frames, int prompt_frames, int iterations) {
+    const int num_phoneme = OjtPhoneme::num_phoneme();
+    const int pau = OjtPhoneme::phoneme_map().at(OjtPhoneme::space_phoneme());
+    const int vowel = OjtPhoneme::phoneme_map().at("a");
+    const int length = pad_frames + prompt_frames;
+
+    std::vector<float> f0(length, 0.0f);
+    std::vector<float> phoneme(length * num_phoneme, 0.0f);
+    for (int i = 0; i < length; i++) {
+        bool voiced = i >= pad_frames;
+        if (voiced) f0[i] = 5.5f;
+        phoneme[i * num_phoneme + (voiced ? vowel : pau)] = 1.0f;
+    }
+    std::vector<float> wave(length * 256);
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        if (!core.decode_forward(length, num_phoneme, f0.data(), phoneme.data(), &speaker_id, wave.data())) {
+            throw std::runtime_error(core.last_error_message());
+        }
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count() / iterations;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        std::fprintf(stderr, "usage: %s <core library> [speaker_id...]\n", argv[0]);
+        return 1;
+    }
+
+    const int iterations = 10;
+    // 短い応答から長めの文まで
+    const float prompt_lengths[] = { 0.3f, 1.0f, 3.0f };
+
+    try {
+        Core core(argv[1], false);
+        std::vector<long> speaker_ids;
+        for (int i = 2; i < argc; i++) speaker_ids.push_back(std::atol(argv[i]));
+        if (speaker_ids.empty()) speaker_ids.push_back(0);
+
+        for (long speaker_id : speaker_ids) {
+            float calibrated = calibrate_pre_padding(&core, speaker_id);
+            int default_frames = padding_frames(DEFAULT_PRE_PADDING_LENGTH);
+            int calibrated_frames = padding_frames(calibrated);
+            std::printf(
+                "speaker=%ld pre_padding %.3fs -> %.3fs (%d -> %d frames, %d saved per request)\n",
+                speaker_id,
+                DEFAULT_PRE_PADDING_LENGTH,
+                calibrated,
+                default_frames,
+                calibrated_frames,
+                default_frames - calibrated_frames
+            );
+
+            for (float prompt_length : prompt_lengths) {
+                int prompt_frames = padding_frames(prompt_length);
+                double default_ms = decode_ms(core, speaker_id, default_frames, prompt_frames, iterations);
+                double calibrated_ms = decode_ms(core, speaker_id, calibrated_frames, prompt_frames, iterations);
+                std::printf(
+                    "  prompt %.1fs: %4d -> %4d frames, %8.2f -> %8.2f ms (%.2fx)\n",
+                    prompt_length,
+                    default_frames + prompt_frames,
+                    calibrated_frames + prompt_frames,
+                    default_ms,
+                    calibrated_ms,
+                    default_ms / calibrated_ms
+                );
+            }
+        }
+        core.finalize();
+    }
+    catch (std::exception &err) {
+        std::fprintf(stderr, "%s\n", err.what());
+        return 1;
+    }
+    return 0;
+}
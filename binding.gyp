@@ -1,4 +1,10 @@
 {
+  "variables": {
+    # node-gyp rebuild --build_benchmarks=true でベンチマークもビルドする
+    "build_benchmarks%": "false",
+    # node-gyp rebuild --memory_accounting=true で段階ごとに確保したメモリを数える
+    "memory_accounting%": "false"
+  },
   "targets": [
     {
       "target_name": "openjtalk",
@@ -109,21 +115,48 @@
         "engine/nlohmann/json.hpp",
         "engine/acoustic_feature_extractor.cc",
         "engine/acoustic_feature_extractor.h",
+        "engine/engine_loader.cc",
+        "engine/engine_loader.h",
+        "engine/engine_metrics.cc",
+        "engine/engine_metrics.h",
+        "engine/flac_encoder.cc",
+        "engine/flac_encoder.h",
         "engine/full_context_label.cc",
         "engine/full_context_label.h",
+        "engine/g711.cc",
+        "engine/g711.h",
         "engine/kana_parser.cc",
         "engine/kana_parser.h",
+        "engine/latency_stats.cc",
+        "engine/latency_stats.h",
+        "engine/memory_stats.cc",
+        "engine/memory_stats.h",
         "engine/mora_list.cc",
         "engine/mora_list.h",
         "engine/openjtalk.cc",
         "engine/openjtalk.h",
         "engine/part_of_speech_data.h",
+        "engine/pcm_kernel.cc",
+        "engine/pcm_kernel.h",
+        "engine/post_process.cc",
+        "engine/post_process.h",
+        "engine/pre_padding.cc",
+        "engine/pre_padding.h",
+        "engine/stage_timer.h",
         "engine/synthesis_engine.cc",
         "engine/synthesis_engine.h",
+        "engine/tracer.cc",
+        "engine/tracer.h",
         "engine/user_dict.cc",
         "engine/user_dict.h",
+        "engine/user_dict_worker.cc",
+        "engine/user_dict_worker.h",
         "engine/uuid_v4.cc",
-        "engine/uuid_v4.h"
+        "engine/uuid_v4.h",
+        "engine/wave_resampler.cc",
+        "engine/wave_resampler.h",
+        "engine/wave_writer.cc",
+        "engine/wave_writer.h"
       ],
       "dependencies": ["openjtalk"],
       "include_dirs": [
@@ -175,8 +208,169 @@
               "GCC_ENABLE_CPP_EXCEPTIONS": "YES", # -fno-exceptions
             }
           }
+        ],
+        [
+          "memory_accounting=='true'",
+          {
+            "defines": [ "ENGINE_MEMORY_ACCOUNTING" ],
+            "conditions": [
+              [
+                "OS=='linux'",
+                {
+                  # Node.js本体のoperator newではなく、このモジュールで置き換えたものを使う
+                  "ldflags": [ "-Wl,-Bsymbolic-functions" ],
+                }
+              ]
+            ]
+          }
         ]
       ]
     }
+  ],
+  "conditions": [
+    [
+      "build_benchmarks=='true'",
+      {
+        "targets": [
+          {
+            "target_name": "pcm_kernel_bench",
+            "type": "executable",
+            "sources": [
+              "bench/pcm_kernel_bench.cc",
+              "engine/pcm_kernel.cc",
+              "engine/pcm_kernel.h"
+            ],
+            "cflags_cc": [ "-O3" ],
+            "xcode_settings": {
+              "GCC_OPTIMIZATION_LEVEL": "3"
+            }
+          },
+          {
+            "target_name": "pre_padding_bench",
+            "type": "executable",
+            "sources": [
+              "bench/pre_padding_bench.cc",
+              "core/core.cc",
+              "core/core.h",
+              "engine/engine_metrics.cc",
+              "engine/latency_stats.cc",
+              "engine/memory_stats.cc",
+              "engine/pre_padding.cc",
+              "engine/pre_padding.h"
+            ],
+            "cflags!": [ "-fno-exceptions" ],
+            "cflags_cc!": [ "-fno-exceptions" ],
+            "conditions": [
+              [
+                "OS=='win'",
+                {
+                  "msvs_settings": {
+                    "VCCLCompilerTool": {
+                      "ExceptionHandling": "2"
+                    },
+                  },
+                }
+              ],
+              [
+                "OS=='linux'",
+                {
+                  "libraries": [ "-ldl" ],
+                }
+              ],
+              [
+                "OS=='mac'",
+                {
+                  "xcode_settings": {
+                    "GCC_ENABLE_CPP_EXCEPTIONS": "YES",
+                  }
+                }
+              ]
+            ]
+          },
+          {
+            "target_name": "pipeline_bench",
+            "type": "executable",
+            "sources": [
+              "bench/pipeline_bench.cc",
+              "engine/acoustic_feature_extractor.cc",
+              "engine/engine_metrics.cc",
+              "engine/flac_encoder.cc",
+              "engine/full_context_label.cc",
+              "engine/g711.cc",
+              "engine/latency_stats.cc",
+              "engine/memory_stats.cc",
+              "engine/mora_list.cc",
+              "engine/openjtalk.cc",
+              "engine/pcm_kernel.cc",
+              "engine/tracer.cc",
+              "engine/user_dict.cc",
+              "engine/uuid_v4.cc",
+              "engine/wave_resampler.cc",
+              "engine/wave_writer.cc"
+            ],
+            "dependencies": ["openjtalk"],
+            "include_dirs": [
+              "<(module_root_dir)/lib/open_jtalk/src/jpcommon",
+              "<(module_root_dir)/lib/open_jtalk/src/mecab/src",
+              "<(module_root_dir)/lib/open_jtalk/src/mecab2njd",
+              "<(module_root_dir)/lib/open_jtalk/src/mecab-naist-jdic",
+              "<(module_root_dir)/lib/open_jtalk/src/njd",
+              "<(module_root_dir)/lib/open_jtalk/src/njd_set_accent_phrase",
+              "<(module_root_dir)/lib/open_jtalk/src/njd_set_accent_type",
+              "<(module_root_dir)/lib/open_jtalk/src/njd_set_digit",
+              "<(module_root_dir)/lib/open_jtalk/src/njd_set_long_vowel",
+              "<(module_root_dir)/lib/open_jtalk/src/njd_set_pronunciation",
+              "<(module_root_dir)/lib/open_jtalk/src/njd_set_unvoiced_vowel",
+              "<(module_root_dir)/lib/open_jtalk/src/njd2jpcommon",
+              "<(module_root_dir)/lib/open_jtalk/src/text2mecab"
+            ],
+            "cflags!": [ "-fno-exceptions" ],
+            "cflags_cc!": [ "-fno-exceptions" ],
+            "cflags_cc": [ "-O2" ],
+            "conditions": [
+              [
+                "OS=='win'",
+                {
+                  "msbuild_settings": {
+                    'ClCompile': {
+                      'AdditionalOptions': ["/utf-8"]
+                    },
+                  },
+                  "msvs_settings": {
+                    "VCCLCompilerTool": {
+                      "ExceptionHandling": "2"
+                    },
+                  },
+                  "libraries": [ "<(module_root_dir)/build/Release/openjtalk.lib" ],
+                }
+              ],
+              [
+                "OS!='win'",
+                {
+                  "libraries": [ "<(module_root_dir)/build/Release/openjtalk.a" ],
+                }
+              ],
+              [
+                "OS=='mac'",
+                {
+                  "xcode_settings": {
+                    "GCC_ENABLE_CPP_EXCEPTIONS": "YES",
+                  }
+                }
+              ]
+            ]
+          },
+          {
+            # モデルを使わず決まった出力を返すコアライブラリ
+            "target_name": "stand_in_core",
+            "type": "shared_library",
+            "sources": [
+              "core/stand_in_core.cc"
+            ],
+            "cflags_cc": [ "-O2" ]
+          }
+        ]
+      }
+    ]
   ]
 }
@@ -1,4 +1,25 @@
+#include <map>
+#include <mutex>
+
 #include "core.h"
+#include "../engine/engine_metrics.h"
+#include "../engine/probes.h"
+
+// コアライブラリは同時に呼び出せることを保証しておらず、初期化やエラーメッセージもプロセスで1つしか持たない
+// そのため、同じライブラリを読み込んだ全てのCoreで、関数の呼び出しとエラーメッセージの取得を直列にする
+static std::mutex core_mutex;
+// ライブラリごとの、finalizeしていないCoreの数。最初のCoreで初期化し、最後のCoreで終了する
+static std::map<HMODULE, int> instance_counts;
+
+// 失敗した呼び出しのエラーメッセージを、呼び出したスレッドごとに保持する
+static thread_local std::string last_error;
+
+// コアライブラリのエラーメッセージは次の呼び出しで上書きされるので、ロックを持ったまま複製する
+static void store_last_error(HMODULE handler)
+{
+	RETURN_CHAR last_error_message = (RETURN_CHAR)GetProcAddress(handler, "last_error_message");
+	last_error = last_error_message();
+}
 
 Core::Core(const std::string core_file_path, bool use_gpu)
 {
@@ -25,10 +46,15 @@ Core::Core(const std::string core_file_path, bool use_gpu)
 		throw std::runtime_error("to load library is succeeded, but can't found needed functions");
 	}
 	m_handler = handler;
-    // TODO: make cpu_num_threads changeable
-    if (!initialize(use_gpu, 0, true)) {
-        throw std::runtime_error("failed to initialize core library");
+    std::lock_guard<std::mutex> lock(core_mutex);
+    // 既に他のCoreが初期化している場合、use_gpuは最初のCoreのものになる
+    if (instance_counts[handler] == 0) {
+        // TODO: make cpu_num_threads changeable
+        if (!initialize(use_gpu, 0, true)) {
+            throw std::runtime_error("failed to initialize core library");
+        }
     }
+    instance_counts[handler]++;
 }
 
 Core::~Core()
@@ -45,7 +71,13 @@ const char *Core::metas()
 bool Core::yukarin_s_forward(int length, long *phoneme_list, long *speaker_id, float *output)
 {
 	YUKARIN_S yukarin = (YUKARIN_S)GetProcAddress(m_handler, "yukarin_s_forward");
-	return yukarin(length, phoneme_list, speaker_id, output);
+	std::lock_guard<std::mutex> lock(core_mutex);
+	ENGINE_PROBE2(core_yukarin_s_forward_entry, *speaker_id, length);
+	bool success = yukarin(length, phoneme_list, speaker_id, output);
+	if (!success) store_last_error(m_handler);
+	ENGINE_PROBE3(core_yukarin_s_forward_return, *speaker_id, length, success);
+	engine_metrics().core_called(CORE_YUKARIN_S_FORWARD, success);
+	return success;
 }
 
 bool Core::yukarin_sa_forward(
@@ -61,7 +93,9 @@ bool Core::yukarin_sa_forward(
 )
 {
 	YUKARIN_SA yukarin = (YUKARIN_SA)GetProcAddress(m_handler, "yukarin_sa_forward");
-	return yukarin(
+	std::lock_guard<std::mutex> lock(core_mutex);
+	ENGINE_PROBE2(core_yukarin_sa_forward_entry, *speaker_id, length);
+	bool success = yukarin(
         length,
         vowel_phoneme_list,
         consonant_phoneme_list,
@@ -72,6 +106,10 @@ bool Core::yukarin_sa_forward(
         speaker_id,
         output
     );
+	if (!success) store_last_error(m_handler);
+	ENGINE_PROBE3(core_yukarin_sa_forward_return, *speaker_id, length, success);
+	engine_metrics().core_called(CORE_YUKARIN_SA_FORWARD, success);
+	return success;
 }
 
 bool Core::decode_forward(
@@ -84,7 +122,9 @@ bool Core::decode_forward(
 )
 {
     DECODE decode = (DECODE)GetProcAddress(m_handler, "decode_forward");
-    return decode(
+    std::lock_guard<std::mutex> lock(core_mutex);
+    ENGINE_PROBE2(core_decode_forward_entry, *speaker_id, length);
+    bool success = decode(
         length,
         phoneme_size,
         f0,
@@ -92,16 +132,24 @@ bool Core::decode_forward(
         speaker_id,
         output
     );
+    if (!success) store_last_error(m_handler);
+    ENGINE_PROBE3(core_decode_forward_return, *speaker_id, length, success);
+    engine_metrics().core_called(CORE_DECODE_FORWARD, success);
+    return success;
 }
 
 const char *Core::last_error_message()
 {
-	RETURN_CHAR last_error_message = (RETURN_CHAR)GetProcAddress(m_handler, "last_error_message");
-	return last_error_message();
+	return last_error.c_str();
 }
 
 void Core::finalize()
 {
+    std::lock_guard<std::mutex> lock(core_mutex);
+    if (m_finalized) return;
+    m_finalized = true;
+    // 他のCoreが使っている間は終了しない
+    if (--instance_counts[m_handler] > 0) return;
     FINAL finalize = (FINAL)GetProcAddress(m_handler, "finalize");
     finalize();
 }
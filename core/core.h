@@ -1,7 +1,7 @@
 #ifndef CORE_H
 #define CORE_H
 
-#include <napi.h>
+#include <stdexcept>
 #include <string>
 
 #if defined(_WIN32) || defined(_WIN64)
@@ -71,12 +71,15 @@ public:
         float *output
     );
 
+    // 呼び出したスレッドで、最後に失敗したコアの関数のエラーメッセージ
     const char *last_error_message();
 
+    // 同じライブラリを読み込んだ全てのCoreがfinalizeした時点で、コアライブラリを終了する
     void finalize();
 
 private:
     HMODULE m_handler;
+    bool m_finalized = false;
 };
 
 #endif // CORE_H
@@ -0,0 +1,179 @@
+// 本物のコアライブラリの代わりに、モデルを使わず決まった出力を返すコアライブラリ
+// ベンチマークや回帰テストを、モデルを配布できない環境でも動かすために使う
+// 推論にかかる時間の代わりに、以下の環境変数で指定した時間(マイクロ秒)だけCPUを使って待つ
+//   STAND_IN_CORE_YUKARIN_S_US: yukarin_s_forwardの音素1つあたり
+//   STAND_IN_CORE_YUKARIN_SA_US: yukarin_sa_forwardのモーラ1つあたり
+//   STAND_IN_CORE_DECODE_US: decode_forwardのフレーム1つあたり
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+
+#if defined(_WIN32) || defined(_WIN64)
+#define STAND_IN_CORE_EXPORT extern "C" __declspec(dllexport)
+#else
+#define STAND_IN_CORE_EXPORT extern "C" __attribute__((visibility("default")))
+#endif
+
+constexpr double PI = 3.14159265358979323846;
+constexpr int NUM_SPEAKERS = 2;
+constexpr int FRAME_SIZE = 256;
+constexpr int SAMPLING_RATE = 24000;
+// OjtPhoneme::phoneme_mapでの番号
+constexpr long PAU = 0;
+constexpr long CL = 11;
+
+static const char *METAS =
+    "[{\"name\":\"stand-in\",\"speaker_uuid\":\"00000000-0000-4000-8000-000000000000\","
+    "\"styles\":[{\"name\":\"ノーマル\",\"id\":0},{\"name\":\"ひそひそ\",\"id\":1}],"
+    "\"version\":\"0.0.0\"}]";
+
+static bool initialized = false;
+static std::string error_message;
+static long yukarin_s_delay = 0;
+static long yukarin_sa_delay = 0;
+static long decode_delay = 0;
+
+static long read_delay(const char *name) {
+    const char *value = std::getenv(name);
+    if (value == nullptr) return 0;
+    long delay = std::atol(value);
+    return delay > 0 ? delay : 0;
+}
+
+// sleepではなくCPUを使い続けて、推論の負荷を真似る
+static void busy_wait(long microseconds) {
+    if (microseconds <= 0) return;
+    auto end = std::chrono::steady_clock::now() + std::chrono::microseconds(microseconds);
+    while (std::chrono::steady_clock::now() < end) {
+    }
+}
+
+static bool check_arguments(int length, const long *speaker_id) {
+    if (!initialized) {
+        error_message = "stand-in core is not initialized";
+        return false;
+    }
+    if (length < 0 || speaker_id == nullptr || *speaker_id < 0 || *speaker_id >= NUM_SPEAKERS) {
+        error_message = "invalid arguments";
+        return false;
+    }
+    return true;
+}
+
+// 無声の母音(A, E, I, O, U)とpau、cl
+static bool is_unvoiced(long phoneme_id) {
+    return phoneme_id == PAU || (phoneme_id >= 1 && phoneme_id <= 3) || phoneme_id == 5 || phoneme_id == 6 ||
+        phoneme_id == CL;
+}
+
+// 母音(a, e, i, o, u, N)
+static bool is_vowel(long phoneme_id) {
+    return phoneme_id == 4 || phoneme_id == 7 || phoneme_id == 14 || phoneme_id == 21 || phoneme_id == 30 ||
+        phoneme_id == 40;
+}
+
+STAND_IN_CORE_EXPORT bool initialize(bool use_gpu, int cpu_num_threads, bool load_all_models) {
+    yukarin_s_delay = read_delay("STAND_IN_CORE_YUKARIN_S_US");
+    yukarin_sa_delay = read_delay("STAND_IN_CORE_YUKARIN_SA_US");
+    decode_delay = read_delay("STAND_IN_CORE_DECODE_US");
+    initialized = true;
+    return true;
+}
+
+STAND_IN_CORE_EXPORT void finalize() {
+    initialized = false;
+}
+
+STAND_IN_CORE_EXPORT const char *metas() {
+    return METAS;
+}
+
+STAND_IN_CORE_EXPORT const char *last_error_message() {
+    return error_message.c_str();
+}
+
+// 音素の種類と話者で決まる長さ(秒)
+STAND_IN_CORE_EXPORT bool yukarin_s_forward(int length, long *phoneme_list, long *speaker_id, float *output) {
+    if (!check_arguments(length, speaker_id)) return false;
+    busy_wait(yukarin_s_delay * length);
+
+    for (int i = 0; i < length; i++) {
+        long phoneme_id = phoneme_list[i];
+        float phoneme_length = phoneme_id == PAU ? 0.1f : is_vowel(phoneme_id) ? 0.09f : 0.05f;
+        output[i] = phoneme_length + 0.01f * (float)*speaker_id;
+    }
+    return true;
+}
+
+// アクセント核の前を高く、後を低くした対数の音高。無声のモーラは0
+STAND_IN_CORE_EXPORT bool yukarin_sa_forward(
+    int length,
+    long *vowel_phoneme_list,
+    long *consonant_phoneme_list,
+    long *start_accent_list,
+    long *end_accent_list,
+    long *start_accent_phrase_list,
+    long *end_accent_phrase_list,
+    long *speaker_id,
+    float *output
+) {
+    if (!check_arguments(length, speaker_id)) return false;
+    busy_wait(yukarin_sa_delay * length);
+
+    long level = 0;
+    for (int i = 0; i < length; i++) {
+        if (start_accent_phrase_list[i]) level = 0;
+        level += start_accent_list[i];
+        float f0 = 5.5f + 0.15f * (float)level - 0.02f * (float)i / (float)(length > 0 ? length : 1);
+        output[i] = is_unvoiced(vowel_phoneme_list[i]) ? 0.0f : f0 + 0.1f * (float)*speaker_id;
+        level -= end_accent_list[i];
+        if (end_accent_phrase_list[i]) level = 0;
+    }
+    return true;
+}
+
+// 有声のフレームはf0の正弦波、子音は決まった系列の雑音、pauは無音
+// 呼び出しの先頭には、本物のデコーダのような減衰する雑音を足す
+STAND_IN_CORE_EXPORT bool decode_forward(
+    int length,
+    int phoneme_size,
+    float *f0,
+    float *phoneme,
+    long *speaker_id,
+    float *output
+) {
+    if (!check_arguments(length, speaker_id)) return false;
+    busy_wait(decode_delay * length);
+
+    double phase = 0.0;
+    uint32_t noise = 12345u + (uint32_t)*speaker_id;
+    for (int i = 0; i < length; i++) {
+        long phoneme_id = 0;
+        for (int j = 0; j < phoneme_size; j++) {
+            if (phoneme[(size_t)i * phoneme_size + j] > 0.5f) phoneme_id = j;
+        }
+        double frequency = f0[i] > 0.0f ? std::exp((double)f0[i]) : 0.0;
+
+        for (int k = 0; k < FRAME_SIZE; k++) {
+            size_t n = (size_t)i * FRAME_SIZE + k;
+            noise = noise * 1664525u + 1013904223u;
+            double white = (double)(noise >> 8) / (double)(1 << 24) * 2.0 - 1.0;
+
+            double sample = 0.0;
+            if (frequency > 0.0) {
+                phase += 2.0 * PI * frequency / SAMPLING_RATE;
+                sample = 0.3 * std::sin(phase);
+            }
+            else if (phoneme_id != PAU && phoneme_id != CL) {
+                sample = 0.05 * white;
+            }
+            sample += 0.2 * std::exp(-(double)n / 1200.0) * white;
+            output[n] = (float)sample;
+        }
+        phase = std::fmod(phase, 2.0 * PI);
+    }
+    return true;
+}
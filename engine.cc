@@ -1,25 +1,141 @@
 ﻿#include <napi.h>
 
 #include <algorithm>
+#include <chrono>
+#include <exception>
 #include <string>
 
 #include "engine.h"
+#include "engine/engine_loader.h"
+#include "engine/engine_metrics.h"
 #include "engine/kana_parser.h"
+#include "engine/latency_stats.h"
+#include "engine/memory_stats.h"
+#include "engine/tracer.h"
 #include "engine/user_dict.h"
 #include "engine/nlohmann/json.hpp"
 
 using namespace Napi;
 
-Napi::Object EngineWrapper::NewInstance(Napi::Env env, const Napi::CallbackInfo& info)
+// バインディングの呼び出し1回分を、トレースの区間とし、リクエストの種類ごとに数と確保したメモリを集計する
+// JSの例外を投げて戻った場合は失敗として数える
+class RequestScope {
+public:
+    RequestScope(Napi::Env env, RequestKind kind)
+        : m_env(env),
+          m_kind(kind),
+          m_uncaught_exceptions(std::uncaught_exceptions()),
+          m_start(std::chrono::steady_clock::now()),
+          m_trace(request_kind_name(kind)) {
+        engine_metrics().request_started(kind);
+    }
+
+    ~RequestScope() {
+        std::chrono::nanoseconds elapsed = std::chrono::steady_clock::now() - m_start;
+        bool failed = m_env.IsExceptionPending() || std::uncaught_exceptions() > m_uncaught_exceptions;
+        engine_metrics().request_finished(m_kind, (uint64_t)elapsed.count(), failed);
+        if (memory_accounting_enabled) {
+            MemoryUsage usage = m_memory.finish();
+            memory_stats().add(m_kind, usage);
+            engine_metrics().add_memory(m_kind, usage);
+        }
+    }
+
+    RequestScope(const RequestScope &) = delete;
+    RequestScope &operator=(const RequestScope &) = delete;
+
+private:
+    Napi::Env m_env;
+    RequestKind m_kind;
+    int m_uncaught_exceptions;
+    std::chrono::steady_clock::time_point m_start;
+    TraceScope m_trace;
+    MemoryScope m_memory;
+};
+
+// NewInstanceとNewInstanceAsyncの引数を確かめ、正しくない場合はJSの例外を投げてfalseを返す
+static bool check_instance_arguments(Napi::Env env, const Napi::CallbackInfo& info)
 {
-    Napi::EscapableHandleScope scope(env);
     if (info.Length() < 5) {
         Napi::TypeError::New(env, "missing arguments").ThrowAsJavaScriptException();
-        return Napi::Object::New(env);
+        return false;
     }
 
     if (!info[0].IsString() || !info[1].IsString() || !info[2].IsString() || !info[3].IsString() || !info[4].IsBoolean()) {
         Napi::TypeError::New(env, "wrong arguments").ThrowAsJavaScriptException();
+        return false;
+    }
+    return true;
+}
+
+// コアライブラリと辞書の読み込みをlibuvのスレッドプールで行い、終わったらJSのスレッドでEngineWrapperを作る
+class EngineLoadWorker : public Napi::AsyncWorker {
+public:
+    EngineLoadWorker(Napi::Env env, const Napi::CallbackInfo& info)
+        : Napi::AsyncWorker(env),
+          m_deferred(Napi::Promise::Deferred::New(env)),
+          m_openjtalk_dict(info[0].As<Napi::String>().Utf8Value()),
+          m_default_dict_path(info[1].As<Napi::String>().Utf8Value()),
+          m_user_dict_root(info[2].As<Napi::String>().Utf8Value()),
+          m_core_file_path(info[3].As<Napi::String>().Utf8Value()),
+          m_use_gpu(info[4].As<Napi::Boolean>().Value()) {}
+
+    ~EngineLoadWorker() {
+        // EngineWrapperに渡せなかった場合
+        if (m_components.core != nullptr) {
+            m_components.core->finalize();
+            delete m_components.core;
+        }
+    }
+
+    Napi::Promise Promise() { return m_deferred.Promise(); }
+
+protected:
+    void Execute() override {
+        try {
+            m_components = load_engine_components(
+                m_openjtalk_dict, m_default_dict_path, m_user_dict_root, m_core_file_path, m_use_gpu
+            );
+        } catch (std::exception& err) {
+            SetError(err.what());
+        }
+    }
+
+    void OnOK() override {
+        Napi::Env env = Env();
+        try {
+            Napi::Object instance = env.GetInstanceData<Napi::FunctionReference>()->New({
+                Napi::String::New(env, m_openjtalk_dict),
+                Napi::String::New(env, m_default_dict_path),
+                Napi::String::New(env, m_user_dict_root),
+                Napi::String::New(env, m_core_file_path),
+                Napi::Boolean::New(env, m_use_gpu),
+                Napi::External<EngineComponents>::New(env, &m_components),
+            });
+            m_deferred.Resolve(instance);
+        } catch (Napi::Error& err) {
+            m_deferred.Reject(err.Value());
+        }
+    }
+
+    void OnError(const Napi::Error& err) override {
+        m_deferred.Reject(err.Value());
+    }
+
+private:
+    Napi::Promise::Deferred m_deferred;
+    std::string m_openjtalk_dict;
+    std::string m_default_dict_path;
+    std::string m_user_dict_root;
+    std::string m_core_file_path;
+    bool m_use_gpu;
+    EngineComponents m_components;
+};
+
+Napi::Object EngineWrapper::NewInstance(Napi::Env env, const Napi::CallbackInfo& info)
+{
+    Napi::EscapableHandleScope scope(env);
+    if (!check_instance_arguments(env, info)) {
         return Napi::Object::New(env);
     }
 
@@ -28,6 +144,19 @@ Napi::Object EngineWrapper::NewInstance(Napi::Env env, const Napi::CallbackInfo&
     return scope.Escape(napi_value(obj)).ToObject();
 }
 
+Napi::Value EngineWrapper::NewInstanceAsync(const Napi::CallbackInfo& info)
+{
+    Napi::Env env = info.Env();
+    if (!check_instance_arguments(env, info)) {
+        return env.Null();
+    }
+
+    EngineLoadWorker* worker = new EngineLoadWorker(env, info);
+    Napi::Promise promise = worker->Promise();
+    worker->Queue();
+    return promise;
+}
+
 Napi::Object EngineWrapper::Init(Napi::Env env, Napi::Object exports)
 {
     Napi::Function func = DefineClass(
@@ -38,6 +167,15 @@ Napi::Object EngineWrapper::Init(Napi::Env env, Napi::Object exports)
             InstanceMethod("mora_length", &EngineWrapper::mora_length),
             InstanceMethod("mora_pitch", &EngineWrapper::mora_pitch),
             InstanceMethod("synthesis", &EngineWrapper::synthesis),
+            InstanceMethod("synthesis_with_timing", &EngineWrapper::synthesis_with_timing),
+            InstanceMethod("synthesis_concat", &EngineWrapper::synthesis_concat),
+            InstanceMethod("calibrate_pre_padding", &EngineWrapper::calibrate_pre_padding),
+            InstanceMethod("stats", &EngineWrapper::stats),
+            InstanceMethod("metrics", &EngineWrapper::metrics),
+            InstanceMethod("start_trace", &EngineWrapper::start_trace),
+            InstanceMethod("stop_trace", &EngineWrapper::stop_trace),
+            InstanceMethod("dump_trace", &EngineWrapper::dump_trace),
+            InstanceMethod("startup_timings", &EngineWrapper::startup_timings),
             InstanceMethod("metas", &EngineWrapper::metas),
             InstanceMethod("yukarin_s_forward", &EngineWrapper::yukarin_s_forward),
             InstanceMethod("yukarin_sa_forward", &EngineWrapper::yukarin_sa_forward),
@@ -46,6 +184,13 @@ Napi::Object EngineWrapper::Init(Napi::Env env, Napi::Object exports)
             InstanceMethod("add_user_dict_word", &EngineWrapper::add_user_dict_word),
             InstanceMethod("rewrite_user_dict_word", &EngineWrapper::rewrite_user_dict_word),
             InstanceMethod("delete_user_dict_word", &EngineWrapper::delete_user_dict_word),
+            InstanceMethod("add_user_dict_word_async", &EngineWrapper::add_user_dict_word_async),
+            InstanceMethod("rewrite_user_dict_word_async", &EngineWrapper::rewrite_user_dict_word_async),
+            InstanceMethod("delete_user_dict_word_async", &EngineWrapper::delete_user_dict_word_async),
+            InstanceMethod("create_dict_namespace", &EngineWrapper::create_dict_namespace),
+            InstanceMethod("create_dict_namespace_async", &EngineWrapper::create_dict_namespace_async),
+            InstanceMethod("delete_dict_namespace", &EngineWrapper::delete_dict_namespace),
+            InstanceMethod("dict_namespaces", &EngineWrapper::dict_namespaces),
         });
 
     Napi::FunctionReference* constructor = new Napi::FunctionReference();
@@ -53,6 +198,7 @@ Napi::Object EngineWrapper::Init(Napi::Env env, Napi::Object exports)
     env.SetInstanceData(constructor);
 
     exports.Set("EngineWrapper", func);
+    exports.Set("create_async", Napi::Function::New(env, NewInstanceAsync));
     return exports;
 }
 
@@ -64,17 +210,25 @@ EngineWrapper::EngineWrapper(const Napi::CallbackInfo& info)
     std::string user_dict_root = info[2].As<Napi::String>().Utf8Value();
     std::string core_file_path = info[3].As<Napi::String>().Utf8Value();
     bool use_gpu = info[4].As<Napi::Boolean>().Value();
+    m_openjtalk_dict = openjtalk_dict;
+    m_user_dict_root = user_dict_root;
     try {
-        m_core = new Core(core_file_path, use_gpu);
-        m_openjtalk = new OpenJTalk(openjtalk_dict);
-        std::string user_dict_path = user_dict_root + "user_dict.json";
-        std::string compiled_dict_path = user_dict_root + "user.dic";
-        m_openjtalk->default_dict_path = default_dict_path;
-        m_openjtalk->user_dict_path = user_dict_path;
-        m_openjtalk->user_mecab = compiled_dict_path;
-        m_openjtalk = user_dict_startup_processing(m_openjtalk);
-        m_openjtalk = update_dict(m_openjtalk);
+        EngineComponents components;
+        // create_asyncでは、読み込み済みのものが6番目の引数で渡される
+        if (info.Length() >= 6 && info[5].IsExternal()) {
+            EngineComponents* loaded = info[5].As<Napi::External<EngineComponents>>().Data();
+            components = *loaded;
+            loaded->core = nullptr;
+        } else {
+            components = load_engine_components(openjtalk_dict, default_dict_path, user_dict_root, core_file_path, use_gpu);
+        }
+        m_core = components.core;
+        m_openjtalk = components.openjtalk.get();
+        m_dict_namespaces[""] = components.openjtalk;
+        m_default_mecab = components.openjtalk->default_mecab;
+        m_startup_timings = components.startup_timings;
         m_engine = new SynthesisEngine(m_core, m_openjtalk);
+        m_user_dict_worker = new UserDictWorker(info.Env());
     }
     catch (std::exception& err) {
         Napi::Error::New(info.Env(), err.what()).ThrowAsJavaScriptException();
@@ -83,9 +237,16 @@ EngineWrapper::EngineWrapper(const Napi::CallbackInfo& info)
 
 EngineWrapper::~EngineWrapper()
 {
-    m_core->finalize();
-    delete m_core;
-    m_core = nullptr;
+    delete m_user_dict_worker;
+    m_user_dict_worker = nullptr;
+    delete m_engine;
+    m_engine = nullptr;
+    // 読み込みに失敗した場合はnullptrのまま
+    if (m_core != nullptr) {
+        m_core->finalize();
+        delete m_core;
+        m_core = nullptr;
+    }
 }
 
 void EngineWrapper::create_execute_error(Napi::Env env, const char* func_name)
@@ -95,8 +256,19 @@ void EngineWrapper::create_execute_error(Napi::Env env, const char* func_name)
     Napi::Error::New(env, err).ThrowAsJavaScriptException();
 }
 
+std::shared_ptr<OpenJTalk> EngineWrapper::find_dict_namespace(Napi::Value name)
+{
+    std::string key = name.IsString() ? name.As<Napi::String>().Utf8Value() : "";
+    auto found = m_dict_namespaces.find(key);
+    if (found == m_dict_namespaces.end()) {
+        throw std::runtime_error("dictionary namespace not found: " + key);
+    }
+    return found->second;
+}
+
 Napi::Value EngineWrapper::audio_query(const Napi::CallbackInfo& info) {
     Napi::Env env = info.Env();
+    RequestScope request(env, REQUEST_AUDIO_QUERY);
     if (info.Length() < 2) {
         Napi::TypeError::New(env, "missing arguments").ThrowAsJavaScriptException();
         return env.Null();
@@ -107,9 +279,15 @@ Napi::Value EngineWrapper::audio_query(const Napi::CallbackInfo& info) {
         return env.Null();
     }
 
+    if (info.Length() >= 3 && !(info[2].IsUndefined() || info[2].IsString())) {
+        Napi::TypeError::New(env, "wrong arguments").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
     Napi::Array accent_phrases;
     try {
-        accent_phrases = m_engine->create_accent_phrases(env, info[0].As<Napi::String>(), info[1].As<Napi::Number>());
+        std::shared_ptr<OpenJTalk> openjtalk = find_dict_namespace(info[2]);
+        accent_phrases = m_engine->create_accent_phrases(env, info[0].As<Napi::String>(), info[1].As<Napi::Number>(), openjtalk.get());
     } catch (std::exception& err) {
         Napi::Error::New(info.Env(), err.what()).ThrowAsJavaScriptException();
         return env.Null();
@@ -141,6 +319,7 @@ Napi::Value EngineWrapper::audio_query(const Napi::CallbackInfo& info) {
 
 Napi::Value EngineWrapper::accent_phrases(const Napi::CallbackInfo& info) {
     Napi::Env env = info.Env();
+    RequestScope request(env, REQUEST_ACCENT_PHRASES);
     if (info.Length() < 3) {
         Napi::TypeError::New(env, "missing arguments").ThrowAsJavaScriptException();
         return env.Null();
@@ -151,6 +330,11 @@ Napi::Value EngineWrapper::accent_phrases(const Napi::CallbackInfo& info) {
         return env.Null();
     }
 
+    if (info.Length() >= 4 && !(info[3].IsUndefined() || info[3].IsString())) {
+        Napi::TypeError::New(env, "wrong arguments").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
     Napi::Array accent_phrases;
     if (info[2].As<Napi::Boolean>().Value()) {
         try {
@@ -163,7 +347,14 @@ Napi::Value EngineWrapper::accent_phrases(const Napi::CallbackInfo& info) {
         accent_phrases = m_engine->replace_mora_data(accent_phrases, info[1].As<Napi::Number>().Int64Value());
     }
     else {
-        accent_phrases = m_engine->create_accent_phrases(env, info[0].As<Napi::String>(), info[1].As<Napi::Number>());
+        try {
+            std::shared_ptr<OpenJTalk> openjtalk = find_dict_namespace(info[3]);
+            accent_phrases = m_engine->create_accent_phrases(env, info[0].As<Napi::String>(), info[1].As<Napi::Number>(), openjtalk.get());
+        }
+        catch (std::exception& err) {
+            Napi::Error::New(info.Env(), err.what()).ThrowAsJavaScriptException();
+            return env.Null();
+        }
     }
 
     return accent_phrases;
@@ -171,6 +362,7 @@ Napi::Value EngineWrapper::accent_phrases(const Napi::CallbackInfo& info) {
 
 Napi::Value EngineWrapper::mora_data(const Napi::CallbackInfo& info) {
     Napi::Env env = info.Env();
+    RequestScope request(env, REQUEST_MORA_DATA);
     if (info.Length() < 2) {
         Napi::TypeError::New(env, "missing arguments").ThrowAsJavaScriptException();
         return env.Null();
@@ -187,6 +379,7 @@ Napi::Value EngineWrapper::mora_data(const Napi::CallbackInfo& info) {
 
 Napi::Value EngineWrapper::mora_length(const Napi::CallbackInfo& info) {
     Napi::Env env = info.Env();
+    RequestScope request(env, REQUEST_MORA_LENGTH);
     if (info.Length() < 2) {
         Napi::TypeError::New(env, "missing arguments").ThrowAsJavaScriptException();
         return env.Null();
@@ -203,6 +396,7 @@ Napi::Value EngineWrapper::mora_length(const Napi::CallbackInfo& info) {
 
 Napi::Value EngineWrapper::mora_pitch(const Napi::CallbackInfo& info) {
     Napi::Env env = info.Env();
+    RequestScope request(env, REQUEST_MORA_PITCH);
     if (info.Length() < 2) {
         Napi::TypeError::New(env, "missing arguments").ThrowAsJavaScriptException();
         return env.Null();
@@ -217,19 +411,63 @@ Napi::Value EngineWrapper::mora_pitch(const Napi::CallbackInfo& info) {
     return m_engine->replace_mora_pitch(info[0].As<Napi::Array>(), info[1].As<Napi::Number>().Int64Value());
 }
 
-Napi::Value EngineWrapper::synthesis(const Napi::CallbackInfo& info) {
-    Napi::Env env = info.Env();
-    if (info.Length() < 3) {
-        Napi::TypeError::New(env, "missing arguments").ThrowAsJavaScriptException();
-        return env.Null();
+// optionsの中で、省略可能な真偽値を読む。不正な値の場合はJavaScriptの例外を設定してfalseを返す
+static bool get_optional_boolean(Napi::Env env, Napi::Object options, const char *name, bool &result) {
+    Napi::Value value = options.Get(name);
+    if (value.IsUndefined()) return true;
+    if (!value.IsBoolean()) {
+        Napi::TypeError::New(env, "wrong arguments").ThrowAsJavaScriptException();
+        return false;
     }
+    result = value.As<Napi::Boolean>().Value();
+    return true;
+}
 
-    if (!info[0].IsObject() || !info[1].IsNumber() || !info[2].IsBoolean()) {
+// 省略可能な数値を読む。値があればhas_valueをtrueにする
+static bool get_optional_number(Napi::Env env, Napi::Object options, const char *name, float &result, bool &has_value) {
+    Napi::Value value = options.Get(name);
+    has_value = false;
+    if (value.IsUndefined()) return true;
+    if (!value.IsNumber()) {
         Napi::TypeError::New(env, "wrong arguments").ThrowAsJavaScriptException();
-        return env.Null();
+        return false;
     }
+    result = value.As<Napi::Number>().FloatValue();
+    has_value = true;
+    return true;
+}
 
-    Napi::Object audio_query = info[0].As<Napi::Object>();
+// synthesisのoptionsを読む。不正な値の場合はJavaScriptの例外を設定してfalseを返す
+static bool parse_synthesis_options(Napi::Env env, Napi::Value value, SynthesisOptions &synthesis_options) {
+    synthesis_options = SynthesisOptions();
+    if (value.IsUndefined()) return true;
+    if (!value.IsObject()) {
+        Napi::TypeError::New(env, "wrong arguments").ThrowAsJavaScriptException();
+        return false;
+    }
+
+    Napi::Object options = value.As<Napi::Object>();
+    Napi::Value format_value = options.Get("format");
+    if (!format_value.IsUndefined()) {
+        if (
+            !format_value.IsString() ||
+            !parse_wave_format(format_value.As<Napi::String>().Utf8Value(), synthesis_options.format)
+        ) {
+            Napi::TypeError::New(env, "unknown output format").ThrowAsJavaScriptException();
+            return false;
+        }
+    }
+
+    PostProcessOptions &post_process = synthesis_options.post_process;
+    bool has_value;
+    return get_optional_boolean(env, options, "directSilence", synthesis_options.direct_silence) &&
+        get_optional_boolean(env, options, "trimSilence", post_process.trim) &&
+        get_optional_number(env, options, "trimThreshold", post_process.trim_threshold, has_value) &&
+        get_optional_number(env, options, "normalizeLoudness", post_process.target_loudness, post_process.normalize);
+}
+
+// AudioQueryの各項目の型と値の範囲を確かめる。不正な場合はJavaScriptの例外を設定してfalseを返す
+static bool check_audio_query(Napi::Env env, Napi::Object audio_query) {
     if (
         !audio_query.Has("accent_phrases") ||
         !audio_query.Has("speedScale") ||
@@ -243,7 +481,7 @@ Napi::Value EngineWrapper::synthesis(const Napi::CallbackInfo& info) {
         !audio_query.Has("kana")
     ) {
         Napi::TypeError::New(env, "wrong audio query").ThrowAsJavaScriptException();
-        return env.Null();
+        return false;
     }
 
     // TODO: accent_phraseの厳密な型検査
@@ -270,10 +508,252 @@ Napi::Value EngineWrapper::synthesis(const Napi::CallbackInfo& info) {
         !kana.IsString()
     ) {
         Napi::TypeError::New(env, "wrong audio query params").ThrowAsJavaScriptException();
+        return false;
+    }
+
+    int sampling_rate = output_sampling_rate.As<Napi::Number>().Int32Value();
+    if (sampling_rate < MIN_OUTPUT_SAMPLING_RATE || sampling_rate > MAX_OUTPUT_SAMPLING_RATE) {
+        Napi::RangeError::New(env, "outputSamplingRate is out of range").ThrowAsJavaScriptException();
+        return false;
+    }
+    return true;
+}
+
+Napi::Value EngineWrapper::synthesis(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    RequestScope request(env, REQUEST_SYNTHESIS);
+    if (info.Length() < 3) {
+        Napi::TypeError::New(env, "missing arguments").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    if (!info[0].IsObject() || !info[1].IsNumber() || !info[2].IsBoolean()) {
+        Napi::TypeError::New(env, "wrong arguments").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    SynthesisOptions options;
+    if (!parse_synthesis_options(env, info[3], options)) {
+        return env.Null();
+    }
+
+    Napi::Object audio_query = info[0].As<Napi::Object>();
+    if (!check_audio_query(env, audio_query)) {
+        return env.Null();
+    }
+
+    return m_engine->synthesis_wave_format(
+        env,
+        audio_query,
+        info[1].As<Napi::Number>().Int64Value(),
+        info[2].As<Napi::Boolean>().Value(),
+        options
+    );
+}
+
+Napi::Value EngineWrapper::synthesis_with_timing(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    RequestScope request(env, REQUEST_SYNTHESIS_WITH_TIMING);
+    if (info.Length() < 3) {
+        Napi::TypeError::New(env, "missing arguments").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    if (!info[0].IsObject() || !info[1].IsNumber() || !info[2].IsBoolean()) {
+        Napi::TypeError::New(env, "wrong arguments").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    SynthesisOptions options;
+    if (!parse_synthesis_options(env, info[3], options)) {
+        return env.Null();
+    }
+
+    Napi::Object audio_query = info[0].As<Napi::Object>();
+    if (!check_audio_query(env, audio_query)) {
+        return env.Null();
+    }
+
+    try {
+        return m_engine->synthesis_with_timing(
+            env,
+            audio_query,
+            info[1].As<Napi::Number>().Int64Value(),
+            info[2].As<Napi::Boolean>().Value(),
+            options
+        );
+    }
+    catch (std::exception& err) {
+        Napi::Error::New(info.Env(), err.what()).ThrowAsJavaScriptException();
+        return env.Null();
+    }
+}
+
+Napi::Value EngineWrapper::synthesis_concat(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    RequestScope request(env, REQUEST_SYNTHESIS_CONCAT);
+    if (info.Length() < 2) {
+        Napi::TypeError::New(env, "missing arguments").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    if (!info[0].IsArray() || !info[1].IsBoolean()) {
+        Napi::TypeError::New(env, "wrong arguments").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    SynthesisOptions options;
+    if (!parse_synthesis_options(env, info[2], options)) {
+        return env.Null();
+    }
+
+    Napi::Array segment_array = info[0].As<Napi::Array>();
+    if (segment_array.Length() == 0) {
+        Napi::TypeError::New(env, "wrong arguments").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    std::vector<SynthesisSegment> segments;
+    for (uint32_t i = 0; i < segment_array.Length(); i++) {
+        Napi::Value segment_value = segment_array[i];
+        if (!segment_value.IsObject()) {
+            Napi::TypeError::New(env, "wrong arguments").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+        Napi::Object segment_object = segment_value.As<Napi::Object>();
+        Napi::Value audio_query = segment_object.Get("audio_query");
+        Napi::Value speaker_id = segment_object.Get("speaker_id");
+        Napi::Value silence_after = segment_object.Get("silence_after");
+        if (
+            !audio_query.IsObject() ||
+            !speaker_id.IsNumber() ||
+            !(silence_after.IsUndefined() || silence_after.IsNumber())
+        ) {
+            Napi::TypeError::New(env, "wrong arguments").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+        if (!check_audio_query(env, audio_query.As<Napi::Object>())) {
+            return env.Null();
+        }
+
+        SynthesisSegment segment;
+        segment.query = audio_query.As<Napi::Object>();
+        segment.speaker_id = speaker_id.As<Napi::Number>().Int64Value();
+        segment.silence_after = silence_after.IsNumber() ? silence_after.As<Napi::Number>().FloatValue() : 0.0f;
+        segments.push_back(segment);
+    }
+
+    try {
+        return m_engine->synthesis_concat(env, segments, info[1].As<Napi::Boolean>().Value(), options);
+    }
+    catch (std::exception& err) {
+        Napi::Error::New(info.Env(), err.what()).ThrowAsJavaScriptException();
+        return env.Null();
+    }
+}
+
+Napi::Value EngineWrapper::calibrate_pre_padding(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    if (info.Length() < 1) {
+        Napi::TypeError::New(env, "missing arguments").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    if (!info[0].IsNumber()) {
+        Napi::TypeError::New(env, "wrong arguments").ThrowAsJavaScriptException();
         return env.Null();
     }
 
-    return m_engine->synthesis_wave_format(env, audio_query, info[1].As<Napi::Number>().Int64Value(), info[2].As<Napi::Boolean>().Value());
+    try {
+        float length = m_engine->calibrate_pre_padding(info[0].As<Napi::Number>().Int64Value());
+        return Napi::Number::New(env, length);
+    }
+    catch (std::exception& err) {
+        Napi::Error::New(info.Env(), err.what()).ThrowAsJavaScriptException();
+        return env.Null();
+    }
+}
+
+static Napi::Object memory_snapshot_object(Napi::Env env, const MemorySnapshot &snapshot) {
+    Napi::Object memory = Napi::Object::New(env);
+    memory.Set("count", Napi::Number::New(env, (double)snapshot.count));
+    memory.Set("allocated_bytes", Napi::Number::New(env, (double)snapshot.allocated_bytes));
+    memory.Set("peak_bytes", Napi::Number::New(env, (double)snapshot.peak_bytes));
+    return memory;
+}
+
+Napi::Value EngineWrapper::stats(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    bool reset = false;
+    if (info.Length() >= 1 && !info[0].IsUndefined()) {
+        if (!info[0].IsBoolean()) {
+            Napi::TypeError::New(env, "wrong arguments").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+        reset = info[0].As<Napi::Boolean>().Value();
+    }
+
+    Napi::Object stages = Napi::Object::New(env);
+    for (int i = 0; i < LATENCY_STAGE_COUNT; i++) {
+        LatencyStage stage = (LatencyStage)i;
+        LatencySnapshot snapshot = latency_stats().snapshot(stage, reset);
+
+        Napi::Array buckets = Napi::Array::New(env, snapshot.buckets.size());
+        for (size_t j = 0; j < snapshot.buckets.size(); j++) {
+            buckets[j] = Napi::Number::New(env, (double)snapshot.buckets[j]);
+        }
+        Napi::Object stage_stats = Napi::Object::New(env);
+        stage_stats.Set("count", Napi::Number::New(env, (double)snapshot.count));
+        stage_stats.Set("total_ms", Napi::Number::New(env, (double)snapshot.total_ns / 1e6));
+        stage_stats.Set("max_ms", Napi::Number::New(env, (double)snapshot.max_ns / 1e6));
+        stage_stats.Set("p50_ms", Napi::Number::New(env, snapshot.percentile(0.5)));
+        stage_stats.Set("p95_ms", Napi::Number::New(env, snapshot.percentile(0.95)));
+        stage_stats.Set("p99_ms", Napi::Number::New(env, snapshot.percentile(0.99)));
+        stage_stats.Set("buckets", buckets);
+        stage_stats.Set("memory", memory_snapshot_object(env, memory_stats().snapshot(stage, reset)));
+        stages.Set(latency_stage_name(stage), stage_stats);
+    }
+
+    Napi::Object requests = Napi::Object::New(env);
+    for (int i = 0; i < REQUEST_KIND_COUNT; i++) {
+        RequestKind kind = (RequestKind)i;
+        Napi::Object request_stats = Napi::Object::New(env);
+        request_stats.Set("memory", memory_snapshot_object(env, memory_stats().snapshot(kind, reset)));
+        requests.Set(request_kind_name(kind), request_stats);
+    }
+
+    Napi::Object result = Napi::Object::New(env);
+    result.Set("stages", stages);
+    result.Set("requests", requests);
+    result.Set("memory_accounting", Napi::Boolean::New(env, memory_accounting_enabled));
+    return result;
+}
+
+Napi::Value EngineWrapper::startup_timings(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    Napi::Object result = Napi::Object::New(env);
+    for (const std::pair<std::string, double> &timing : m_startup_timings) {
+        result.Set(timing.first, Napi::Number::New(env, timing.second));
+    }
+    return result;
+}
+
+Napi::Value EngineWrapper::metrics(const Napi::CallbackInfo& info) {
+    return Napi::String::New(info.Env(), engine_metrics().prometheus_text());
+}
+
+Napi::Value EngineWrapper::start_trace(const Napi::CallbackInfo& info) {
+    start_tracing();
+    return info.Env().Undefined();
+}
+
+Napi::Value EngineWrapper::stop_trace(const Napi::CallbackInfo& info) {
+    stop_tracing();
+    return info.Env().Undefined();
+}
+
+Napi::Value EngineWrapper::dump_trace(const Napi::CallbackInfo& info) {
+    return Napi::String::New(info.Env(), ::dump_trace());
 }
 
 Napi::Value EngineWrapper::metas(const Napi::CallbackInfo& info)
@@ -465,9 +945,14 @@ Napi::Value EngineWrapper::decode_forward(const Napi::CallbackInfo& info)
 
 Napi::Value EngineWrapper::get_user_dict_words(const Napi::CallbackInfo& info) {
     Napi::Env env = info.Env();
+    if (info.Length() >= 1 && !(info[0].IsUndefined() || info[0].IsString())) {
+        Napi::TypeError::New(env, "wrong arguments").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
     json user_dict;
     try {
-        user_dict = read_dict(m_openjtalk->user_dict_path);
+        user_dict = read_dict(find_dict_namespace(info[0])->user_dict_path);
     } catch (std::exception& err) {
         Napi::Error::New(info.Env(), err.what()).ThrowAsJavaScriptException();
         return env.Null();
@@ -519,6 +1004,11 @@ Napi::Value EngineWrapper::add_user_dict_word(const Napi::CallbackInfo& info) {
         return env.Null();
     }
 
+    if (info.Length() >= 6 && !(info[5].IsUndefined() || info[5].IsString())) {
+        Napi::TypeError::New(env, "wrong arguments").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
     std::string surface = info[0].As<Napi::String>().Utf8Value();
     std::string pronunciation = info[1].As<Napi::String>().Utf8Value();
     int accent_type = info[2].As<Napi::Number>().Int32Value();
@@ -536,8 +1026,9 @@ Napi::Value EngineWrapper::add_user_dict_word(const Napi::CallbackInfo& info) {
     }
     std::string word_uuid;
     try {
+        std::shared_ptr<OpenJTalk> openjtalk = find_dict_namespace(info[5]);
         auto result = apply_word(
-            m_openjtalk,
+            openjtalk.get(),
             surface,
             pronunciation,
             accent_type,
@@ -545,8 +1036,6 @@ Napi::Value EngineWrapper::add_user_dict_word(const Napi::CallbackInfo& info) {
             priority
         );
         word_uuid = result.first;
-        m_openjtalk = result.second;
-        m_engine->update_openjtalk(m_openjtalk);
     } catch (std::exception& err) {
         Napi::Error::New(info.Env(), err.what()).ThrowAsJavaScriptException();
         return env.Null();
@@ -572,7 +1061,12 @@ Napi::Value EngineWrapper::rewrite_user_dict_word(const Napi::CallbackInfo& info
         return env.Null();
     }
 
-    if (info.Length() == 6 && !(info[5].IsUndefined() || info[5].IsNumber())) {
+    if (info.Length() >= 6 && !(info[5].IsUndefined() || info[5].IsNumber())) {
+        Napi::TypeError::New(env, "wrong arguments").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    if (info.Length() >= 7 && !(info[6].IsUndefined() || info[6].IsString())) {
         Napi::TypeError::New(env, "wrong arguments").ThrowAsJavaScriptException();
         return env.Null();
     }
@@ -594,8 +1088,9 @@ Napi::Value EngineWrapper::rewrite_user_dict_word(const Napi::CallbackInfo& info
         priority = &priority_value;
     }
     try {
-        m_openjtalk = rewrite_word(
-            m_openjtalk,
+        std::shared_ptr<OpenJTalk> openjtalk = find_dict_namespace(info[6]);
+        rewrite_word(
+            openjtalk.get(),
             word_uuid,
             surface,
             pronunciation,
@@ -603,7 +1098,6 @@ Napi::Value EngineWrapper::rewrite_user_dict_word(const Napi::CallbackInfo& info
             word_type,
             priority
         );
-        m_engine->update_openjtalk(m_openjtalk);
     } catch (std::exception& err) {
         Napi::Error::New(info.Env(), err.what()).ThrowAsJavaScriptException();
         return env.Null();
@@ -619,18 +1113,18 @@ Napi::Value EngineWrapper::delete_user_dict_word(const Napi::CallbackInfo& info)
         return env.Null();
     }
 
-    if (!info[0].IsString()) {
+    if (!info[0].IsString() || !(info[1].IsUndefined() || info[1].IsString())) {
         Napi::TypeError::New(env, "wrong arguments").ThrowAsJavaScriptException();
         return env.Null();
     }
 
     std::string word_uuid = info[0].As<Napi::String>().Utf8Value();
     try {
-        m_openjtalk = delete_word(
-            m_openjtalk,
+        std::shared_ptr<OpenJTalk> openjtalk = find_dict_namespace(info[1]);
+        delete_word(
+            openjtalk.get(),
             word_uuid
         );
-        m_engine->update_openjtalk(m_openjtalk);
     } catch (std::exception& err) {
         Napi::Error::New(info.Env(), err.what()).ThrowAsJavaScriptException();
         return env.Null();
@@ -639,6 +1133,319 @@ Napi::Value EngineWrapper::delete_user_dict_word(const Napi::CallbackInfo& info)
     return env.Null();
 }
 
+Napi::Value EngineWrapper::add_user_dict_word_async(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    if (info.Length() < 3) {
+        Napi::TypeError::New(env, "missing arguments").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    if (!info[0].IsString() || !info[1].IsString() || !info[2].IsNumber()) {
+        Napi::TypeError::New(env, "wrong arguments").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    if (info.Length() >= 4 && !(info[3].IsUndefined() || info[3].IsString())) {
+        Napi::TypeError::New(env, "wrong arguments").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    if (info.Length() >= 5 && !(info[4].IsUndefined() || info[4].IsNumber())) {
+        Napi::TypeError::New(env, "wrong arguments").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    if (info.Length() >= 6 && !(info[5].IsUndefined() || info[5].IsString())) {
+        Napi::TypeError::New(env, "wrong arguments").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    std::string surface = info[0].As<Napi::String>().Utf8Value();
+    std::string pronunciation = info[1].As<Napi::String>().Utf8Value();
+    int accent_type = info[2].As<Napi::Number>().Int32Value();
+    std::string *word_type = nullptr;
+    std::string word_type_value;
+    if (info[3].IsString()) {
+        word_type_value = info[3].As<Napi::String>().Utf8Value();
+        word_type = &word_type_value;
+    }
+    int *priority = nullptr;
+    int priority_value;
+    if (info[4].IsNumber()) {
+        priority_value = info[4].As<Napi::Number>().Int32Value();
+        priority = &priority_value;
+    }
+
+    std::shared_ptr<OpenJTalk> openjtalk;
+    try {
+        openjtalk = find_dict_namespace(info[5]);
+    } catch (std::exception& err) {
+        Napi::Error::New(info.Env(), err.what()).ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    return m_user_dict_worker->add_word(env, openjtalk, surface, pronunciation, accent_type, word_type, priority);
+}
+
+Napi::Value EngineWrapper::rewrite_user_dict_word_async(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    if (info.Length() < 4) {
+        Napi::TypeError::New(env, "missing arguments").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    if (!info[0].IsString() || !info[1].IsString() || !info[2].IsNumber() || !info[3].IsString()) {
+        Napi::TypeError::New(env, "wrong arguments").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    if (info.Length() >= 5 && !(info[4].IsUndefined() || info[4].IsString())) {
+        Napi::TypeError::New(env, "wrong arguments").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    if (info.Length() >= 6 && !(info[5].IsUndefined() || info[5].IsNumber())) {
+        Napi::TypeError::New(env, "wrong arguments").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    if (info.Length() >= 7 && !(info[6].IsUndefined() || info[6].IsString())) {
+        Napi::TypeError::New(env, "wrong arguments").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    std::string surface = info[0].As<Napi::String>().Utf8Value();
+    std::string pronunciation = info[1].As<Napi::String>().Utf8Value();
+    int accent_type = info[2].As<Napi::Number>().Int32Value();
+    std::string word_uuid = info[3].As<Napi::String>().Utf8Value();
+    std::string *word_type = nullptr;
+    std::string word_type_value;
+    if (info[4].IsString()) {
+        word_type_value = info[4].As<Napi::String>().Utf8Value();
+        word_type = &word_type_value;
+    }
+    int *priority = nullptr;
+    int priority_value;
+    if (info[5].IsNumber()) {
+        priority_value = info[5].As<Napi::Number>().Int32Value();
+        priority = &priority_value;
+    }
+
+    std::shared_ptr<OpenJTalk> openjtalk;
+    try {
+        openjtalk = find_dict_namespace(info[6]);
+    } catch (std::exception& err) {
+        Napi::Error::New(info.Env(), err.what()).ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    return m_user_dict_worker->rewrite_word(env, openjtalk, word_uuid, surface, pronunciation, accent_type, word_type, priority);
+}
+
+Napi::Value EngineWrapper::delete_user_dict_word_async(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    if (info.Length() < 1) {
+        Napi::TypeError::New(env, "missing arguments").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    if (!info[0].IsString() || !(info[1].IsUndefined() || info[1].IsString())) {
+        Napi::TypeError::New(env, "wrong arguments").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    std::shared_ptr<OpenJTalk> openjtalk;
+    try {
+        openjtalk = find_dict_namespace(info[1]);
+    } catch (std::exception& err) {
+        Napi::Error::New(info.Env(), err.what()).ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    return m_user_dict_worker->delete_word(env, openjtalk, info[0].As<Napi::String>().Utf8Value());
+}
+
+// 名前空間名はファイル名に使うため、英数字と-_のみを許可する
+static bool is_valid_dict_namespace(const std::string &name) {
+    if (name.empty() || name.size() > 64) return false;
+    for (char c : name) {
+        bool valid = ('0' <= c && c <= '9') || ('A' <= c && c <= 'Z') || ('a' <= c && c <= 'z') || c == '-' || c == '_';
+        if (!valid) return false;
+    }
+    return true;
+}
+
+// 名前空間の辞書の読み込みとユーザー辞書のコンパイルをlibuvのスレッドプールで行い、終わったらJSのスレッドで登録する
+class DictNamespaceWorker : public Napi::AsyncWorker {
+public:
+    DictNamespaceWorker(
+        Napi::Env env,
+        Napi::Object engine,
+        std::map<std::string, std::shared_ptr<OpenJTalk>> &namespaces,
+        std::set<std::string> &pending,
+        const std::string &name,
+        const std::string &dn_mecab,
+        const std::string &default_mecab,
+        const std::string &user_dict_path,
+        const std::string &user_mecab
+    ) : Napi::AsyncWorker(env),
+        m_deferred(Napi::Promise::Deferred::New(env)),
+        m_engine(Napi::Persistent(engine)),
+        m_namespaces(namespaces),
+        m_pending(pending),
+        m_name(name),
+        m_dn_mecab(dn_mecab),
+        m_default_mecab(default_mecab),
+        m_user_dict_path(user_dict_path),
+        m_user_mecab(user_mecab) {}
+
+    Napi::Promise Promise() { return m_deferred.Promise(); }
+
+protected:
+    void Execute() override {
+        try {
+            m_openjtalk = load_dict_namespace(m_dn_mecab, m_default_mecab, m_user_dict_path, m_user_mecab);
+        } catch (std::exception& err) {
+            SetError(err.what());
+        }
+    }
+
+    void OnOK() override {
+        m_pending.erase(m_name);
+        m_namespaces[m_name] = m_openjtalk;
+        m_deferred.Resolve(Env().Undefined());
+    }
+
+    void OnError(const Napi::Error& err) override {
+        m_pending.erase(m_name);
+        m_deferred.Reject(err.Value());
+    }
+
+private:
+    Napi::Promise::Deferred m_deferred;
+    // 登録が終わるまでEngineWrapperが破棄されないよう、参照を持つ
+    Napi::ObjectReference m_engine;
+    std::map<std::string, std::shared_ptr<OpenJTalk>> &m_namespaces;
+    std::set<std::string> &m_pending;
+    std::string m_name;
+    std::string m_dn_mecab;
+    std::string m_default_mecab;
+    std::string m_user_dict_path;
+    std::string m_user_mecab;
+    std::shared_ptr<OpenJTalk> m_openjtalk;
+};
+
+bool EngineWrapper::check_dict_namespace_name(Napi::Env env, const Napi::CallbackInfo& info, std::string &name)
+{
+    if (info.Length() < 1) {
+        Napi::TypeError::New(env, "missing arguments").ThrowAsJavaScriptException();
+        return false;
+    }
+
+    if (!info[0].IsString()) {
+        Napi::TypeError::New(env, "wrong arguments").ThrowAsJavaScriptException();
+        return false;
+    }
+
+    name = info[0].As<Napi::String>().Utf8Value();
+    if (!is_valid_dict_namespace(name)) {
+        Napi::Error::New(env, "invalid dictionary namespace name").ThrowAsJavaScriptException();
+        return false;
+    }
+    if (m_pending_dict_namespaces.find(name) != m_pending_dict_namespaces.end()) {
+        Napi::Error::New(env, "dictionary namespace is being created: " + name).ThrowAsJavaScriptException();
+        return false;
+    }
+    return true;
+}
+
+Napi::Value EngineWrapper::create_dict_namespace(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    std::string name;
+    if (!check_dict_namespace_name(env, info, name)) {
+        return env.Null();
+    }
+    if (m_dict_namespaces.find(name) != m_dict_namespaces.end()) {
+        return env.Null();
+    }
+
+    try {
+        m_dict_namespaces[name] = load_dict_namespace(
+            m_openjtalk_dict,
+            m_default_mecab,
+            m_user_dict_root + "user_dict." + name + ".json",
+            m_user_dict_root + "user." + name + ".dic"
+        );
+    } catch (std::exception& err) {
+        Napi::Error::New(info.Env(), err.what()).ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    return env.Null();
+}
+
+Napi::Value EngineWrapper::create_dict_namespace_async(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    std::string name;
+    if (!check_dict_namespace_name(env, info, name)) {
+        return env.Null();
+    }
+    if (m_dict_namespaces.find(name) != m_dict_namespaces.end()) {
+        Napi::Promise::Deferred deferred = Napi::Promise::Deferred::New(env);
+        deferred.Resolve(env.Undefined());
+        return deferred.Promise();
+    }
+
+    m_pending_dict_namespaces.insert(name);
+    DictNamespaceWorker* worker = new DictNamespaceWorker(
+        env,
+        info.This().As<Napi::Object>(),
+        m_dict_namespaces,
+        m_pending_dict_namespaces,
+        name,
+        m_openjtalk_dict,
+        m_default_mecab,
+        m_user_dict_root + "user_dict." + name + ".json",
+        m_user_dict_root + "user." + name + ".dic"
+    );
+    Napi::Promise promise = worker->Promise();
+    worker->Queue();
+    return promise;
+}
+
+Napi::Value EngineWrapper::delete_dict_namespace(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    if (info.Length() < 1) {
+        Napi::TypeError::New(env, "missing arguments").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    if (!info[0].IsString()) {
+        Napi::TypeError::New(env, "wrong arguments").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    std::string name = info[0].As<Napi::String>().Utf8Value();
+    if (name.empty() || m_dict_namespaces.erase(name) == 0) {
+        Napi::Error::New(env, "dictionary namespace not found: " + name).ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    return env.Null();
+}
+
+Napi::Value EngineWrapper::dict_namespaces(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    Napi::Array names = Napi::Array::New(env);
+    uint32_t count = 0;
+    for (auto &item : m_dict_namespaces) {
+        if (item.first.empty()) continue;
+        names[count] = Napi::String::New(env, item.first);
+        count++;
+    }
+    return names;
+}
+
 Napi::Object CreateObject(const Napi::CallbackInfo& info) {
     return EngineWrapper::NewInstance(info.Env(), info);
 }
@@ -3,14 +3,24 @@
 
 #include <napi.h>
 
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
 #include "core/core.h"
 #include "engine/openjtalk.h"
 #include "engine/synthesis_engine.h"
+#include "engine/user_dict_worker.h"
 
 class EngineWrapper : public Napi::ObjectWrap<EngineWrapper> {
 public:
     static Napi::Object Init(Napi::Env env, Napi::Object exports);
     static Napi::Object NewInstance(Napi::Env env, const Napi::CallbackInfo& info);
+    // NewInstanceと同じ引数を受け取り、読み込みを別のスレッドで行ってPromiseで返す
+    static Napi::Value NewInstanceAsync(const Napi::CallbackInfo& info);
 
     EngineWrapper(const Napi::CallbackInfo& info);
     ~EngineWrapper();
@@ -21,6 +31,15 @@ public:
     Napi::Value mora_length(const Napi::CallbackInfo& info);
     Napi::Value mora_pitch(const Napi::CallbackInfo& info);
     Napi::Value synthesis(const Napi::CallbackInfo& info);
+    Napi::Value synthesis_with_timing(const Napi::CallbackInfo& info);
+    Napi::Value synthesis_concat(const Napi::CallbackInfo& info);
+    Napi::Value calibrate_pre_padding(const Napi::CallbackInfo& info);
+    Napi::Value stats(const Napi::CallbackInfo& info);
+    Napi::Value metrics(const Napi::CallbackInfo& info);
+    Napi::Value start_trace(const Napi::CallbackInfo& info);
+    Napi::Value stop_trace(const Napi::CallbackInfo& info);
+    Napi::Value dump_trace(const Napi::CallbackInfo& info);
+    Napi::Value startup_timings(const Napi::CallbackInfo& info);
 
     Napi::Value metas(const Napi::CallbackInfo& info);
 
@@ -32,13 +51,37 @@ public:
     Napi::Value add_user_dict_word(const Napi::CallbackInfo& info);
     Napi::Value rewrite_user_dict_word(const Napi::CallbackInfo& info);
     Napi::Value delete_user_dict_word(const Napi::CallbackInfo& info);
+    Napi::Value add_user_dict_word_async(const Napi::CallbackInfo& info);
+    Napi::Value rewrite_user_dict_word_async(const Napi::CallbackInfo& info);
+    Napi::Value delete_user_dict_word_async(const Napi::CallbackInfo& info);
+
+    Napi::Value create_dict_namespace(const Napi::CallbackInfo& info);
+    Napi::Value create_dict_namespace_async(const Napi::CallbackInfo& info);
+    Napi::Value delete_dict_namespace(const Napi::CallbackInfo& info);
+    Napi::Value dict_namespaces(const Napi::CallbackInfo& info);
 
 private:
     void create_execute_error(Napi::Env env, const char* func_name);
+    std::shared_ptr<OpenJTalk> find_dict_namespace(Napi::Value name);
+    // 名前空間の名前を確かめ、正しくないか作成中の場合はJSの例外を投げてfalseを返す
+    bool check_dict_namespace_name(Napi::Env env, const Napi::CallbackInfo& info, std::string &name);
+
+    Core* m_core = nullptr;
+    OpenJTalk* m_openjtalk = nullptr;
+    SynthesisEngine* m_engine = nullptr;
+    UserDictWorker* m_user_dict_worker = nullptr;
+    // 起動の段階ごとにかかった時間(ミリ秒)
+    std::vector<std::pair<std::string, double>> m_startup_timings;
 
-    Core* m_core;
-    OpenJTalk* m_openjtalk;
-    SynthesisEngine* m_engine;
+    std::string m_openjtalk_dict;
+    // 全ての名前空間で共有する、既定の辞書をコンパイルしたもの
+    std::string m_default_mecab;
+    std::string m_user_dict_root;
+    // 名前空間ごとのユーザー辞書。既定の辞書は空文字列をキーとして保持する
+    // CoreとSynthesisEngineは全ての名前空間で共有する
+    std::map<std::string, std::shared_ptr<OpenJTalk>> m_dict_namespaces;
+    // create_dict_namespace_asyncで作成中の名前空間
+    std::set<std::string> m_pending_dict_namespaces;
 };
 
 #endif // WRAPPER_H
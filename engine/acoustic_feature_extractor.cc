@@ -1,3 +1,5 @@
+#include <algorithm>
+
 #include "acoustic_feature_extractor.h"
 
 long OjtPhoneme::phoneme_id() {
@@ -14,3 +16,43 @@ std::vector<OjtPhoneme> OjtPhoneme::convert(std::vector<OjtPhoneme> phonemes) {
     }
     return phonemes;
 }
+
+std::vector<OjtPhoneme> to_phoneme_data_list(std::vector<std::string> phoneme_str_list) {
+    std::vector<OjtPhoneme> phoneme_data_list;
+    for (size_t i = 0; i < phoneme_str_list.size(); i++) {
+        phoneme_data_list.push_back(OjtPhoneme(phoneme_str_list[i], (float)i, (float)i + 1.0));
+    }
+    return OjtPhoneme::convert(phoneme_data_list);
+}
+
+void split_mora(
+    std::vector<OjtPhoneme> phoneme_list,
+    std::vector<OjtPhoneme> &consonant_phoneme_list,
+    std::vector<OjtPhoneme> &vowel_phoneme_list,
+    std::vector<long> &vowel_indexes
+) {
+    for (size_t i = 0; i < phoneme_list.size(); i++) {
+        std::vector<std::string>::iterator result = std::find(
+            mora_phoneme_list.begin(),
+            mora_phoneme_list.end(),
+            phoneme_list[i].phoneme
+        );
+        if (result != mora_phoneme_list.end()) {
+            vowel_indexes.push_back((long)i);
+        }
+    }
+    for (int index : vowel_indexes) {
+        vowel_phoneme_list.push_back(phoneme_list[index]);
+    }
+    consonant_phoneme_list.push_back(OjtPhoneme());
+    for (size_t i = 0; i < vowel_indexes.size() - 1; i++) {
+        int prev = vowel_indexes[i];
+        int next = vowel_indexes[1 + i];
+        if (next - prev == 1) {
+            consonant_phoneme_list.push_back(OjtPhoneme());
+        } else {
+            consonant_phoneme_list.push_back(phoneme_list[next - 1]);
+        }
+    }
+    return;
+}
@@ -1,44 +1,71 @@
 #ifndef ACOUSTIC_FEATURE_EXTRACTOR_H
 #define ACOUSTIC_FEATURE_EXTRACTOR_H
 
+#include <cstdlib>
 #include <iterator>
 #include <map>
 #include <random>
 #include <string>
 #include <vector>
 
-inline std::vector<float> resample(std::vector<float> base_array, float rate, float sampling_rate, int index = 0) {
-    int length = (int)(base_array.size() / rate * sampling_rate);
+// resampleで間引く位置をずらす量(0以上1未満)
+// 環境変数VOICEVOX_RESAMPLE_OFFSETが設定されていればその値に固定し、同じ入力から常に同じ音声を合成する
+// 設定されていなければ呼び出しごとに乱数で決める
+inline float resample_offset() {
+    static const float fixed_offset = []() {
+        const char *value = std::getenv("VOICEVOX_RESAMPLE_OFFSET");
+        if (value == nullptr || *value == '\0') return -1.0f;
+        float offset = std::strtof(value, nullptr);
+        return offset >= 0.0f && offset < 1.0f ? offset : 0.0f;
+    }();
+    if (fixed_offset >= 0.0f) return fixed_offset;
 
-    std::vector<float> new_array;
-    float calc_rate = rate / sampling_rate;
     std::random_device seed_gen;
     std::mt19937 engine(seed_gen());
     std::uniform_real_distribution<float> dist(0.0, 1.0);
-    float rand_value = dist(engine);
+    return dist(engine);
+}
+
+// resampleで新しい配列の各要素を取る、元の配列での位置
+inline std::vector<int> resample_indexes(size_t base_size, float rate, float sampling_rate, float offset, int index = 0) {
+    int length = (int)(base_size / rate * sampling_rate);
+
+    std::vector<int> indexes;
+    float calc_rate = rate / sampling_rate;
     for (int i = 0; i < length; i++) {
-        int j = (int)((rand_value + (float)(index + i)) * calc_rate);
+        indexes.push_back((int)((offset + (float)(index + i)) * calc_rate));
+    }
+    return indexes;
+}
+
+inline std::vector<int> resample_indexes(size_t base_size, float rate, float sampling_rate) {
+    return resample_indexes(base_size, rate, sampling_rate, resample_offset());
+}
+
+inline std::vector<float> resample(const std::vector<float> &base_array, const std::vector<int> &indexes) {
+    std::vector<float> new_array;
+    for (int j : indexes) {
         new_array.push_back(base_array[j]);
     }
     return new_array;
 }
 
-inline std::vector<float> resample(std::vector<std::vector<float>> base_array, float rate, float sampling_rate, int index = 0) {
-    int length = (int)(base_array.size() / rate * sampling_rate);
-
+inline std::vector<float> resample(const std::vector<std::vector<float>> &base_array, const std::vector<int> &indexes) {
     std::vector<float> new_array;
-    float calc_rate = rate / sampling_rate;
-    std::random_device seed_gen;
-    std::mt19937 engine(seed_gen());
-    std::uniform_real_distribution<float> dist(0.0, 1.0);
-    float rand_value = dist(engine);
-    for (int i = 0; i < length; i++) {
-        int j = (int)((rand_value + (float)(index + i)) * calc_rate);
+    for (int j : indexes) {
         std::copy(base_array[j].begin(), base_array[j].end(), std::back_inserter(new_array));
     }
     return new_array;
 }
 
+inline std::vector<float> resample(std::vector<float> base_array, float rate, float sampling_rate, int index = 0) {
+    return resample(base_array, resample_indexes(base_array.size(), rate, sampling_rate, resample_offset(), index));
+}
+
+inline std::vector<float> resample(std::vector<std::vector<float>> base_array, float rate, float sampling_rate, int index = 0) {
+    return resample(base_array, resample_indexes(base_array.size(), rate, sampling_rate, resample_offset(), index));
+}
+
 // TODO: 現状のHiroshiba/voiceovox_engineではOjtしか使われていないので、一旦これのみ実装した
 class OjtPhoneme {
 public:
@@ -78,4 +105,20 @@ public:
     static std::vector<OjtPhoneme> convert(std::vector<OjtPhoneme> phonemes);
 };
 
+static std::vector<std::string> unvoiced_mora_phoneme_list = {
+    "A", "I", "U", "E", "O", "cl", "pau"
+};
+
+static std::vector<std::string> mora_phoneme_list = {
+    "a", "i", "u", "e", "o", "N", "A", "I", "U", "E", "O", "cl", "pau"
+};
+
+std::vector<OjtPhoneme> to_phoneme_data_list(std::vector<std::string> phoneme_str_list);
+void split_mora(
+    std::vector<OjtPhoneme> phoneme_list,
+    std::vector<OjtPhoneme> &consonant_phoneme_list,
+    std::vector<OjtPhoneme> &vowel_phoneme_list,
+    std::vector<long> &vowel_indexes
+);
+
 #endif // ACOUSTIC_FEATURE_EXTRACTOR_H
@@ -0,0 +1,76 @@
+#include <chrono>
+#include <exception>
+#include <thread>
+
+#include "engine_loader.h"
+#include "tracer.h"
+#include "user_dict.h"
+
+static double elapsed_ms(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+EngineComponents load_engine_components(
+    const std::string &openjtalk_dict,
+    const std::string &default_dict_path,
+    const std::string &user_dict_root,
+    const std::string &core_file_path,
+    bool use_gpu
+) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    // モデルの読み込みが起動時間の大半を占めるので、辞書の準備と重ねる
+    Core *core = nullptr;
+    std::exception_ptr core_error;
+    double core_init_ms = 0.0;
+    std::thread core_thread([&]() {
+        TraceScope trace("core_init");
+        std::chrono::steady_clock::time_point core_start = std::chrono::steady_clock::now();
+        try {
+            core = new Core(core_file_path, use_gpu);
+        } catch (...) {
+            core_error = std::current_exception();
+        }
+        core_init_ms = elapsed_ms(core_start);
+    });
+
+    EngineComponents components;
+    std::exception_ptr dict_error;
+    try {
+        std::chrono::steady_clock::time_point phase_start = std::chrono::steady_clock::now();
+        {
+            TraceScope trace("mecab_load");
+            components.openjtalk = std::make_shared<OpenJTalk>(openjtalk_dict);
+        }
+        components.startup_timings.push_back(std::make_pair(std::string("mecab_load"), elapsed_ms(phase_start)));
+
+        // 既定の辞書は全ての名前空間で共有するものを1回だけコンパイルする
+        phase_start = std::chrono::steady_clock::now();
+        components.openjtalk->default_mecab = compile_default_dict(
+            openjtalk_dict, default_dict_path, user_dict_root + "default.dic"
+        );
+        components.startup_timings.push_back(std::make_pair(std::string("default_dict"), elapsed_ms(phase_start)));
+
+        // ユーザー辞書の単語をコンパイルし、既定の辞書と一緒に読み込み直す
+        phase_start = std::chrono::steady_clock::now();
+        components.openjtalk->user_dict_path = user_dict_root + "user_dict.json";
+        components.openjtalk->user_mecab = user_dict_root + "user.dic";
+        update_dict(components.openjtalk.get());
+        components.startup_timings.push_back(std::make_pair(std::string("user_dict"), elapsed_ms(phase_start)));
+    } catch (...) {
+        dict_error = std::current_exception();
+    }
+
+    core_thread.join();
+    if (core_error || dict_error) {
+        if (core != nullptr) {
+            core->finalize();
+            delete core;
+        }
+        std::rethrow_exception(core_error ? core_error : dict_error);
+    }
+    components.core = core;
+    components.startup_timings.insert(components.startup_timings.begin(), std::make_pair(std::string("core_init"), core_init_ms));
+    components.startup_timings.push_back(std::make_pair(std::string("total"), elapsed_ms(start)));
+    return components;
+}
@@ -0,0 +1,30 @@
+#ifndef ENGINE_LOADER_H
+#define ENGINE_LOADER_H
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "../core/core.h"
+#include "openjtalk.h"
+
+// 起動時に読み込むもの。JSのスレッド以外でも作れるよう、Napiに依存するものは含めない
+struct EngineComponents {
+    Core *core = nullptr;
+    std::shared_ptr<OpenJTalk> openjtalk;
+    // 起動の段階ごとにかかった時間(ミリ秒)。段階の名前はcore_init, mecab_load, default_dict, user_dict, total
+    std::vector<std::pair<std::string, double>> startup_timings;
+};
+
+// コアライブラリとモデルの初期化を別のスレッドで行い、その間にMeCabの辞書の読み込みと、既定の辞書とユーザー辞書のコンパイルを行う
+// どちらかが失敗した場合は、両方が終わってから読み込んだものを解放し、例外を投げる
+EngineComponents load_engine_components(
+    const std::string &openjtalk_dict,
+    const std::string &default_dict_path,
+    const std::string &user_dict_root,
+    const std::string &core_file_path,
+    bool use_gpu
+);
+
+#endif // ENGINE_LOADER_H
@@ -0,0 +1,154 @@
+#include <iomanip>
+#include <locale>
+#include <sstream>
+
+#include "engine_metrics.h"
+
+static const char *core_function_names[CORE_FUNCTION_COUNT] = {
+    "yukarin_s_forward",
+    "yukarin_sa_forward",
+    "decode_forward",
+};
+
+const char *core_function_name(CoreFunction function) {
+    return core_function_names[function];
+}
+
+EngineMetrics::EngineMetrics() {
+    for (int i = 0; i < REQUEST_KIND_COUNT; i++) {
+        m_requests[i].store(0, std::memory_order_relaxed);
+        m_request_errors[i].store(0, std::memory_order_relaxed);
+        m_requests_in_flight[i].store(0, std::memory_order_relaxed);
+        m_request_ns[i].store(0, std::memory_order_relaxed);
+    }
+    for (int i = 0; i < CORE_FUNCTION_COUNT; i++) {
+        m_core_calls[i].store(0, std::memory_order_relaxed);
+        m_core_errors[i].store(0, std::memory_order_relaxed);
+    }
+    m_user_dict_queue.store(0, std::memory_order_relaxed);
+    m_synthesized_audio_us.store(0, std::memory_order_relaxed);
+    m_synthesis_ns.store(0, std::memory_order_relaxed);
+}
+
+void EngineMetrics::request_started(RequestKind kind) {
+    m_requests[kind].fetch_add(1, std::memory_order_relaxed);
+    m_requests_in_flight[kind].fetch_add(1, std::memory_order_relaxed);
+}
+
+void EngineMetrics::request_finished(RequestKind kind, uint64_t elapsed_ns, bool failed) {
+    m_requests_in_flight[kind].fetch_sub(1, std::memory_order_relaxed);
+    m_request_ns[kind].fetch_add(elapsed_ns, std::memory_order_relaxed);
+    if (failed) m_request_errors[kind].fetch_add(1, std::memory_order_relaxed);
+}
+
+void EngineMetrics::core_called(CoreFunction function, bool success) {
+    m_core_calls[function].fetch_add(1, std::memory_order_relaxed);
+    if (!success) m_core_errors[function].fetch_add(1, std::memory_order_relaxed);
+}
+
+void EngineMetrics::add_synthesis(double audio_seconds, uint64_t elapsed_ns) {
+    m_synthesized_audio_us.fetch_add((uint64_t)(audio_seconds * 1e6), std::memory_order_relaxed);
+    m_synthesis_ns.fetch_add(elapsed_ns, std::memory_order_relaxed);
+}
+
+// 1つの指標のHELPとTYPEの行
+static void write_header(std::ostringstream &out, const char *name, const char *type, const char *help) {
+    out << "# HELP " << name << " " << help << "\n";
+    out << "# TYPE " << name << " " << type << "\n";
+}
+
+static void write_sample(std::ostringstream &out, const char *name, const char *label, const char *value_name, double value) {
+    out << name;
+    if (label != nullptr) out << "{" << label << "=\"" << value_name << "\"}";
+    out << " " << value << "\n";
+}
+
+// 2のべき乗マイクロ秒のバケットを、上端を秒にした累積のバケットとして書く
+static void write_histogram(std::ostringstream &out, const char *name, const char *label, const char *value_name, const LatencySnapshot &snapshot) {
+    std::string labels = label != nullptr ? std::string(label) + "=\"" + value_name + "\"," : std::string();
+    uint64_t cumulative = 0;
+    // 最後のバケットは上端がないので+Infにまとめる
+    for (size_t i = 0; i + 1 < snapshot.buckets.size(); i++) {
+        cumulative += snapshot.buckets[i];
+        out << name << "_bucket{" << labels << "le=\"" << (double)((uint64_t)1 << i) / 1e6 << "\"} " << cumulative << "\n";
+    }
+    out << name << "_bucket{" << labels << "le=\"+Inf\"} " << snapshot.count << "\n";
+    labels = label != nullptr ? "{" + std::string(label) + "=\"" + value_name + "\"}" : std::string();
+    out << name << "_sum" << labels << " " << (double)snapshot.total_ns / 1e9 << "\n";
+    out << name << "_count" << labels << " " << snapshot.count << "\n";
+}
+
+std::string EngineMetrics::prometheus_text() {
+    std::ostringstream out;
+    out.imbue(std::locale::classic());
+    out << std::setprecision(9);
+
+    write_header(out, "voicevox_engine_requests_total", "counter", "Calls to each engine method.");
+    for (int i = 0; i < REQUEST_KIND_COUNT; i++) {
+        double value = (double)m_requests[i].load(std::memory_order_relaxed);
+        write_sample(out, "voicevox_engine_requests_total", "method", request_kind_name((RequestKind)i), value);
+    }
+    write_header(out, "voicevox_engine_request_errors_total", "counter", "Calls to each engine method that threw.");
+    for (int i = 0; i < REQUEST_KIND_COUNT; i++) {
+        double value = (double)m_request_errors[i].load(std::memory_order_relaxed);
+        write_sample(out, "voicevox_engine_request_errors_total", "method", request_kind_name((RequestKind)i), value);
+    }
+    write_header(out, "voicevox_engine_requests_in_flight", "gauge", "Calls to each engine method currently running.");
+    for (int i = 0; i < REQUEST_KIND_COUNT; i++) {
+        double value = (double)m_requests_in_flight[i].load(std::memory_order_relaxed);
+        write_sample(out, "voicevox_engine_requests_in_flight", "method", request_kind_name((RequestKind)i), value);
+    }
+    write_header(out, "voicevox_engine_request_seconds_total", "counter", "Time spent in each engine method.");
+    for (int i = 0; i < REQUEST_KIND_COUNT; i++) {
+        double value = (double)m_request_ns[i].load(std::memory_order_relaxed) / 1e9;
+        write_sample(out, "voicevox_engine_request_seconds_total", "method", request_kind_name((RequestKind)i), value);
+    }
+
+    write_header(out, "voicevox_engine_stage_duration_seconds", "histogram", "Duration of each synthesis pipeline stage.");
+    for (int i = 0; i < LATENCY_STAGE_COUNT; i++) {
+        LatencyStage stage = (LatencyStage)i;
+        write_histogram(out, "voicevox_engine_stage_duration_seconds", "stage", latency_stage_name(stage), m_stage_duration[i].snapshot(false));
+    }
+
+    write_header(out, "voicevox_engine_core_calls_total", "counter", "Calls to each core library function.");
+    for (int i = 0; i < CORE_FUNCTION_COUNT; i++) {
+        double value = (double)m_core_calls[i].load(std::memory_order_relaxed);
+        write_sample(out, "voicevox_engine_core_calls_total", "function", core_function_name((CoreFunction)i), value);
+    }
+    write_header(out, "voicevox_engine_core_errors_total", "counter", "Calls to each core library function that failed.");
+    for (int i = 0; i < CORE_FUNCTION_COUNT; i++) {
+        double value = (double)m_core_errors[i].load(std::memory_order_relaxed);
+        write_sample(out, "voicevox_engine_core_errors_total", "function", core_function_name((CoreFunction)i), value);
+    }
+
+    write_header(out, "voicevox_engine_user_dict_rebuild_seconds", "histogram", "Duration of user dictionary rebuilds.");
+    write_histogram(out, "voicevox_engine_user_dict_rebuild_seconds", nullptr, nullptr, m_dict_rebuild.snapshot(false));
+    write_header(out, "voicevox_engine_user_dict_queue_depth", "gauge", "User dictionary changes waiting to be applied.");
+    write_sample(out, "voicevox_engine_user_dict_queue_depth", nullptr, nullptr, (double)m_user_dict_queue.load(std::memory_order_relaxed));
+
+    write_header(out, "voicevox_engine_synthesized_audio_seconds_total", "counter", "Length of synthesized audio.");
+    write_sample(out, "voicevox_engine_synthesized_audio_seconds_total", nullptr, nullptr, (double)m_synthesized_audio_us.load(std::memory_order_relaxed) / 1e6);
+    write_header(out, "voicevox_engine_synthesis_seconds_total", "counter", "Time spent synthesizing audio.");
+    write_sample(out, "voicevox_engine_synthesis_seconds_total", nullptr, nullptr, (double)m_synthesis_ns.load(std::memory_order_relaxed) / 1e9);
+
+    if (memory_accounting_enabled) {
+        write_header(out, "voicevox_engine_stage_allocated_bytes_total", "counter", "Bytes allocated in each synthesis pipeline stage.");
+        for (int i = 0; i < LATENCY_STAGE_COUNT; i++) {
+            LatencyStage stage = (LatencyStage)i;
+            double value = (double)m_stage_memory[i].snapshot(false).allocated_bytes;
+            write_sample(out, "voicevox_engine_stage_allocated_bytes_total", "stage", latency_stage_name(stage), value);
+        }
+        write_header(out, "voicevox_engine_request_allocated_bytes_total", "counter", "Bytes allocated in each engine method.");
+        for (int i = 0; i < REQUEST_KIND_COUNT; i++) {
+            RequestKind kind = (RequestKind)i;
+            double value = (double)m_request_memory[i].snapshot(false).allocated_bytes;
+            write_sample(out, "voicevox_engine_request_allocated_bytes_total", "method", request_kind_name(kind), value);
+        }
+    }
+    return out.str();
+}
+
+EngineMetrics &engine_metrics() {
+    static EngineMetrics metrics;
+    return metrics;
+}
@@ -0,0 +1,62 @@
+#ifndef ENGINE_METRICS_H
+#define ENGINE_METRICS_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#include "latency_stats.h"
+#include "memory_stats.h"
+
+// 呼び出しを数えるコアライブラリの関数
+enum CoreFunction {
+    CORE_YUKARIN_S_FORWARD,
+    CORE_YUKARIN_SA_FORWARD,
+    CORE_DECODE_FORWARD,
+    CORE_FUNCTION_COUNT,
+};
+
+const char *core_function_name(CoreFunction function);
+
+// リクエスト、段階ごとの時間と確保したメモリ、コアライブラリの呼び出し、ユーザー辞書の再構築、合成した音声の長さを数える
+// stats(true)で0に戻るlatency_stats()とmemory_stats()とは別に持ち、Prometheusのカウンタとしてそのまま使える
+// プロセス全体で1つをengine_metrics()で共有する
+class EngineMetrics {
+public:
+    EngineMetrics();
+
+    void request_started(RequestKind kind);
+    void request_finished(RequestKind kind, uint64_t elapsed_ns, bool failed);
+    void stage_recorded(LatencyStage stage, uint64_t elapsed_ns) { m_stage_duration[stage].add(elapsed_ns); }
+    void add_memory(LatencyStage stage, const MemoryUsage &usage) { m_stage_memory[stage].add(usage); }
+    void add_memory(RequestKind kind, const MemoryUsage &usage) { m_request_memory[kind].add(usage); }
+    void core_called(CoreFunction function, bool success);
+    void dict_rebuilt(uint64_t elapsed_ns) { m_dict_rebuild.add(elapsed_ns); }
+    // ユーザー辞書の変更のうち、結果を返していないものの数の増減
+    void add_user_dict_queue(int64_t delta) { m_user_dict_queue.fetch_add(delta, std::memory_order_relaxed); }
+    // 合成した音声の長さと、合成にかかった時間。両者の比が実時間比(RTF)になる
+    void add_synthesis(double audio_seconds, uint64_t elapsed_ns);
+
+    // 全ての値を、Prometheusのテキスト形式で出力する
+    std::string prometheus_text();
+
+private:
+    std::atomic<uint64_t> m_requests[REQUEST_KIND_COUNT];
+    std::atomic<uint64_t> m_request_errors[REQUEST_KIND_COUNT];
+    std::atomic<int64_t> m_requests_in_flight[REQUEST_KIND_COUNT];
+    std::atomic<uint64_t> m_request_ns[REQUEST_KIND_COUNT];
+    LatencyHistogram m_stage_duration[LATENCY_STAGE_COUNT];
+    MemoryCounter m_stage_memory[LATENCY_STAGE_COUNT];
+    MemoryCounter m_request_memory[REQUEST_KIND_COUNT];
+    std::atomic<uint64_t> m_core_calls[CORE_FUNCTION_COUNT];
+    std::atomic<uint64_t> m_core_errors[CORE_FUNCTION_COUNT];
+    LatencyHistogram m_dict_rebuild;
+    std::atomic<int64_t> m_user_dict_queue;
+    // 音声の長さはマイクロ秒単位の整数で足し合わせる
+    std::atomic<uint64_t> m_synthesized_audio_us;
+    std::atomic<uint64_t> m_synthesis_ns;
+};
+
+EngineMetrics &engine_metrics();
+
+#endif // ENGINE_METRICS_H
@@ -0,0 +1,494 @@
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#include "flac_encoder.h"
+
+constexpr int MAX_LPC_ORDER = 8;
+constexpr int MAX_FIXED_ORDER = 4;
+constexpr int LPC_PRECISION = 12;
+constexpr int MAX_PARTITION_ORDER = 8;
+// 4bitのライス符号パラメータで表せる最大値(15はエスケープ)
+constexpr int MAX_RICE_PARAMETER = 14;
+
+// MSBから順にビットを詰めていく
+class BitWriter {
+public:
+    BitWriter(std::vector<uint8_t> &output) : m_output(output) {}
+
+    // bitsは32以下
+    void write(uint64_t value, int bits) {
+        if (bits == 0) return;
+        m_buffer = (m_buffer << bits) | (value & ((1ULL << bits) - 1));
+        m_bits += bits;
+        while (m_bits >= 8) {
+            m_bits -= 8;
+            m_output.push_back((uint8_t)(m_buffer >> m_bits));
+        }
+        m_buffer &= (1ULL << m_bits) - 1;
+    }
+
+    void write_unary(uint32_t zeros) {
+        while (zeros >= 32) {
+            write(0, 32);
+            zeros -= 32;
+        }
+        write(1, zeros + 1);
+    }
+
+    void write_rice(int32_t value, int parameter) {
+        // 符号付きの値を0, -1, 1, -2, ...の順に非負の値へ移す
+        uint32_t folded = value < 0 ? ((uint32_t)(-(int64_t)value) << 1) - 1 : (uint32_t)value << 1;
+        write_unary(folded >> parameter);
+        write(folded, parameter);
+    }
+
+    void align() {
+        if (m_bits > 0) write(0, 8 - m_bits);
+    }
+
+private:
+    std::vector<uint8_t> &m_output;
+    uint64_t m_buffer = 0;
+    int m_bits = 0;
+};
+
+static uint8_t crc8(const uint8_t *data, size_t size) {
+    uint8_t crc = 0;
+    for (size_t i = 0; i < size; i++) {
+        crc ^= data[i];
+        for (int j = 0; j < 8; j++) crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x07) : (uint8_t)(crc << 1);
+    }
+    return crc;
+}
+
+static uint16_t crc16(const uint8_t *data, size_t size) {
+    static const std::vector<uint16_t> table = []() {
+        std::vector<uint16_t> table(256);
+        for (int i = 0; i < 256; i++) {
+            uint16_t crc = (uint16_t)(i << 8);
+            for (int j = 0; j < 8; j++) crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x8005) : (uint16_t)(crc << 1);
+            table[i] = crc;
+        }
+        return table;
+    }();
+    uint16_t crc = 0;
+    for (size_t i = 0; i < size; i++) crc = (uint16_t)((crc << 8) ^ table[(crc >> 8) ^ data[i]]);
+    return crc;
+}
+
+static uint32_t fold(int32_t value) {
+    return value < 0 ? ((uint32_t)(-(int64_t)value) << 1) - 1 : (uint32_t)value << 1;
+}
+
+struct RiceCoding {
+    int partition_order = 0;
+    std::vector<int> parameters;
+    uint64_t bits = UINT64_MAX;
+};
+
+// 分割数とパラメータを、符号量の見積もりが最小になるように選ぶ
+static RiceCoding choose_rice_coding(const std::vector<int32_t> &residual, size_t block_size, int predictor_order) {
+    int max_order = 0;
+    while (
+        max_order < MAX_PARTITION_ORDER &&
+        block_size % ((size_t)1 << (max_order + 1)) == 0 &&
+        (block_size >> (max_order + 1)) > (size_t)predictor_order
+    ) {
+        max_order++;
+    }
+
+    // 最も細かい分割での、各区間の折り返した残差の和
+    size_t partitions = (size_t)1 << max_order;
+    size_t partition_size = block_size >> max_order;
+    std::vector<uint64_t> sums(partitions, 0);
+    std::vector<uint64_t> counts(partitions, 0);
+    for (size_t i = 0; i < residual.size(); i++) {
+        size_t partition = (i + predictor_order) / partition_size;
+        sums[partition] += fold(residual[i]);
+        counts[partition]++;
+    }
+
+    RiceCoding best;
+    for (int order = max_order; order >= 0; order--) {
+        RiceCoding coding;
+        coding.partition_order = order;
+        coding.bits = 2 + 4;
+        for (size_t p = 0; p < sums.size(); p++) {
+            int best_parameter = 0;
+            uint64_t best_bits = UINT64_MAX;
+            for (int parameter = 0; parameter <= MAX_RICE_PARAMETER; parameter++) {
+                uint64_t bits = counts[p] * (parameter + 1) + (sums[p] >> parameter);
+                if (bits < best_bits) {
+                    best_bits = bits;
+                    best_parameter = parameter;
+                }
+            }
+            coding.parameters.push_back(best_parameter);
+            coding.bits += 4 + best_bits;
+        }
+        if (coding.bits < best.bits) best = coding;
+
+        // 隣り合う区間をまとめて、一段粗い分割にする
+        for (size_t p = 0; p < sums.size() / 2; p++) {
+            sums[p] = sums[p * 2] + sums[p * 2 + 1];
+            counts[p] = counts[p * 2] + counts[p * 2 + 1];
+        }
+        sums.resize(sums.size() / 2);
+        counts.resize(counts.size() / 2);
+    }
+    return best;
+}
+
+enum SubframeType {
+    SUBFRAME_CONSTANT,
+    SUBFRAME_VERBATIM,
+    SUBFRAME_FIXED,
+    SUBFRAME_LPC,
+};
+
+struct Subframe {
+    SubframeType type = SUBFRAME_VERBATIM;
+    int bits_per_sample = 16;
+    int order = 0;
+    int shift = 0;
+    std::vector<int32_t> coefficients;
+    std::vector<int32_t> residual;
+    RiceCoding coding;
+    uint64_t bits = UINT64_MAX;
+};
+
+static void compute_fixed_residual(const int32_t *x, size_t size, int order, std::vector<int32_t> &residual) {
+    residual.resize(size - order);
+    for (size_t i = order; i < size; i++) {
+        int64_t r;
+        switch (order) {
+        case 0: r = x[i]; break;
+        case 1: r = (int64_t)x[i] - x[i - 1]; break;
+        case 2: r = (int64_t)x[i] - 2 * (int64_t)x[i - 1] + x[i - 2]; break;
+        case 3: r = (int64_t)x[i] - 3 * (int64_t)x[i - 1] + 3 * (int64_t)x[i - 2] - x[i - 3]; break;
+        default: r = (int64_t)x[i] - 4 * (int64_t)x[i - 1] + 6 * (int64_t)x[i - 2] - 4 * (int64_t)x[i - 3] + x[i - 4]; break;
+        }
+        residual[i - order] = (int32_t)r;
+    }
+}
+
+// 量子化できない場合はfalseを返す
+static bool quantize_lpc(const double *lpc, int order, std::vector<int32_t> &coefficients, int &shift) {
+    double max_coefficient = 0.0;
+    for (int i = 0; i < order; i++) max_coefficient = std::max(max_coefficient, std::abs(lpc[i]));
+    if (max_coefficient <= 0.0) return false;
+
+    int exponent;
+    std::frexp(max_coefficient, &exponent);
+    shift = (LPC_PRECISION - 1) - exponent;
+    if (shift < 0) return false;
+    shift = std::min(shift, 15);
+
+    int32_t max_value = (1 << (LPC_PRECISION - 1)) - 1;
+    int32_t min_value = -(1 << (LPC_PRECISION - 1));
+    coefficients.resize(order);
+    // 丸めの誤差を次の係数へ持ち越す
+    double error = 0.0;
+    for (int i = 0; i < order; i++) {
+        error += lpc[i] * (double)(1 << shift);
+        int32_t value = (int32_t)std::lround(error);
+        value = std::max(min_value, std::min(max_value, value));
+        error -= value;
+        coefficients[i] = value;
+    }
+    return true;
+}
+
+static bool compute_lpc_residual(
+    const int32_t *x,
+    size_t size,
+    const std::vector<int32_t> &coefficients,
+    int shift,
+    std::vector<int32_t> &residual
+) {
+    int order = (int)coefficients.size();
+    residual.resize(size - order);
+    for (size_t i = order; i < size; i++) {
+        int64_t prediction = 0;
+        for (int j = 0; j < order; j++) prediction += (int64_t)coefficients[j] * x[i - j - 1];
+        int64_t r = (int64_t)x[i] - (prediction >> shift);
+        if (r > INT32_MAX / 2 || r < INT32_MIN / 2) return false;
+        residual[i - order] = (int32_t)r;
+    }
+    return true;
+}
+
+static Subframe analyze_subframe(const int32_t *x, size_t size, int bits_per_sample) {
+    Subframe best;
+    best.bits_per_sample = bits_per_sample;
+
+    bool constant = true;
+    for (size_t i = 1; i < size && constant; i++) constant = x[i] == x[0];
+    if (constant) {
+        best.type = SUBFRAME_CONSTANT;
+        best.bits = 8 + bits_per_sample;
+        return best;
+    }
+
+    best.type = SUBFRAME_VERBATIM;
+    best.bits = 8 + (uint64_t)size * bits_per_sample;
+
+    // 固定予測は残差の絶対値の和が最小の次数だけを符号量まで見積もる
+    int max_fixed_order = (int)std::min<size_t>(MAX_FIXED_ORDER, size - 1);
+    int fixed_order = 0;
+    uint64_t min_error = UINT64_MAX;
+    std::vector<int32_t> residual;
+    for (int order = 0; order <= max_fixed_order; order++) {
+        compute_fixed_residual(x, size, order, residual);
+        uint64_t error = 0;
+        for (int32_t r : residual) error += (uint64_t)std::abs((int64_t)r);
+        if (error < min_error) {
+            min_error = error;
+            fixed_order = order;
+        }
+    }
+    compute_fixed_residual(x, size, fixed_order, residual);
+    RiceCoding coding = choose_rice_coding(residual, size, fixed_order);
+    uint64_t bits = 8 + (uint64_t)fixed_order * bits_per_sample + coding.bits;
+    if (bits < best.bits) {
+        best.type = SUBFRAME_FIXED;
+        best.order = fixed_order;
+        best.residual = residual;
+        best.coding = coding;
+        best.bits = bits;
+    }
+
+    int max_lpc_order = (int)std::min<size_t>(MAX_LPC_ORDER, size - 1);
+    if (max_lpc_order < 1) return best;
+
+    // 窓をかけた自己相関からLevinson-Durbin法で各次数の係数を求める
+    std::vector<double> windowed(size);
+    for (size_t i = 0; i < size; i++) {
+        double window = 0.5 - 0.5 * std::cos(2.0 * 3.14159265358979323846 * (i + 0.5) / size);
+        windowed[i] = x[i] * window;
+    }
+    double autocorrelation[MAX_LPC_ORDER + 1];
+    for (int lag = 0; lag <= max_lpc_order; lag++) {
+        double sum = 0.0;
+        for (size_t i = lag; i < size; i++) sum += windowed[i] * windowed[i - lag];
+        autocorrelation[lag] = sum;
+    }
+    if (autocorrelation[0] <= 0.0) return best;
+
+    double lpc[MAX_LPC_ORDER] = {};
+    double error = autocorrelation[0];
+    std::vector<int32_t> coefficients;
+    int shift;
+    for (int order = 1; order <= max_lpc_order; order++) {
+        double acc = autocorrelation[order];
+        for (int j = 0; j < order - 1; j++) acc -= lpc[j] * autocorrelation[order - 1 - j];
+        double reflection = acc / error;
+        double previous[MAX_LPC_ORDER];
+        std::copy(lpc, lpc + order - 1, previous);
+        lpc[order - 1] = reflection;
+        for (int j = 0; j < order - 1; j++) lpc[j] = previous[j] - reflection * previous[order - 2 - j];
+        error *= 1.0 - reflection * reflection;
+
+        if (!quantize_lpc(lpc, order, coefficients, shift)) continue;
+        if (!compute_lpc_residual(x, size, coefficients, shift, residual)) continue;
+        coding = choose_rice_coding(residual, size, order);
+        bits = 8 + (uint64_t)order * bits_per_sample + 4 + 5 + (uint64_t)order * LPC_PRECISION + coding.bits;
+        if (bits < best.bits) {
+            best.type = SUBFRAME_LPC;
+            best.order = order;
+            best.shift = shift;
+            best.coefficients = coefficients;
+            best.residual = residual;
+            best.coding = coding;
+            best.bits = bits;
+        }
+        if (error <= 0.0) break;
+    }
+    return best;
+}
+
+static void write_subframe(BitWriter &writer, const Subframe &subframe, const int32_t *x, size_t size) {
+    int bps = subframe.bits_per_sample;
+    switch (subframe.type) {
+    case SUBFRAME_CONSTANT:
+        writer.write(0x00, 8);
+        writer.write((uint32_t)x[0], bps);
+        return;
+    case SUBFRAME_VERBATIM:
+        writer.write(0x02, 8);
+        for (size_t i = 0; i < size; i++) writer.write((uint32_t)x[i], bps);
+        return;
+    case SUBFRAME_FIXED:
+        writer.write((0x08 | subframe.order) << 1, 8);
+        break;
+    case SUBFRAME_LPC:
+        writer.write((0x20 | (subframe.order - 1)) << 1, 8);
+        break;
+    }
+
+    // 予測の初期値
+    for (int i = 0; i < subframe.order; i++) writer.write((uint32_t)x[i], bps);
+    if (subframe.type == SUBFRAME_LPC) {
+        writer.write(LPC_PRECISION - 1, 4);
+        writer.write(subframe.shift, 5);
+        for (int32_t coefficient : subframe.coefficients) writer.write((uint32_t)coefficient, LPC_PRECISION);
+    }
+
+    const RiceCoding &coding = subframe.coding;
+    writer.write(0, 2); // 4bitのライス符号パラメータ
+    writer.write(coding.partition_order, 4);
+    size_t partition_size = size >> coding.partition_order;
+    size_t index = 0;
+    for (size_t p = 0; p < coding.parameters.size(); p++) {
+        int parameter = coding.parameters[p];
+        writer.write(parameter, 4);
+        size_t count = p == 0 ? partition_size - subframe.order : partition_size;
+        for (size_t i = 0; i < count; i++) writer.write_rice(subframe.residual[index++], parameter);
+    }
+}
+
+// フレーム番号はUTF-8と同じ可変長の形式で書き込む
+static void write_frame_number(std::vector<uint8_t> &output, uint64_t value) {
+    if (value < 0x80) {
+        output.push_back((uint8_t)value);
+        return;
+    }
+    int extra_bytes = 1;
+    while (extra_bytes < 6 && value >= (1ULL << (6 + 5 * extra_bytes))) extra_bytes++;
+    uint8_t prefix = (uint8_t)(0xff00 >> (extra_bytes + 1));
+    output.push_back((uint8_t)(prefix | (value >> (6 * extra_bytes))));
+    for (int i = extra_bytes - 1; i >= 0; i--) {
+        output.push_back((uint8_t)(0x80 | ((value >> (6 * i)) & 0x3f)));
+    }
+}
+
+static int sample_rate_code(int sampling_rate) {
+    switch (sampling_rate) {
+    case 88200: return 1;
+    case 176400: return 2;
+    case 192000: return 3;
+    case 8000: return 4;
+    case 16000: return 5;
+    case 22050: return 6;
+    case 24000: return 7;
+    case 32000: return 8;
+    case 44100: return 9;
+    case 48000: return 10;
+    case 96000: return 11;
+    }
+    if (sampling_rate < 65536) return 13;
+    if (sampling_rate % 10 == 0 && sampling_rate / 10 < 65536) return 14;
+    // STREAMINFOの値を使う
+    return 0;
+}
+
+FlacEncoder::FlacEncoder(int num_channels, int sampling_rate, int bits_per_sample, int block_size) {
+    if (num_channels < 1 || num_channels > 8) throw std::runtime_error("unsupported number of channels for flac");
+    if (bits_per_sample != 16 && bits_per_sample != 24) throw std::runtime_error("unsupported bit depth for flac");
+    if (block_size < 16 || block_size > 65535) throw std::runtime_error("unsupported block size for flac");
+
+    m_num_channels = num_channels;
+    m_sampling_rate = sampling_rate;
+    m_bits_per_sample = bits_per_sample;
+    m_block_size = block_size;
+    m_frame_number = 0;
+    m_pending.resize(num_channels);
+}
+
+void FlacEncoder::header(uint64_t total_samples, std::vector<uint8_t> &output) const {
+    const char marker[] = "fLaC";
+    output.insert(output.end(), marker, marker + 4);
+
+    BitWriter writer(output);
+    // 最後のメタデータブロックであるSTREAMINFO(34byte)
+    writer.write(0x80, 8);
+    writer.write(34, 24);
+    writer.write(m_block_size, 16);
+    writer.write(m_block_size, 16);
+    writer.write(0, 24); // フレームの最小サイズ(不明)
+    writer.write(0, 24); // フレームの最大サイズ(不明)
+    writer.write(m_sampling_rate, 20);
+    writer.write(m_num_channels - 1, 3);
+    writer.write(m_bits_per_sample - 1, 5);
+    writer.write(total_samples >> 32, 4);
+    writer.write(total_samples & 0xffffffff, 32);
+    // MD5は計算しない(0は未計算を表す)
+    for (int i = 0; i < 4; i++) writer.write(0, 32);
+}
+
+void FlacEncoder::encode(const int32_t *samples, size_t frames, std::vector<uint8_t> &output) {
+    for (size_t i = 0; i < frames; i++) {
+        for (int channel = 0; channel < m_num_channels; channel++) {
+            m_pending[channel].push_back(samples[i * m_num_channels + channel]);
+        }
+        if (m_pending[0].size() == (size_t)m_block_size) encode_frame(m_block_size, output);
+    }
+}
+
+void FlacEncoder::finish(std::vector<uint8_t> &output) {
+    if (!m_pending[0].empty()) encode_frame(m_pending[0].size(), output);
+}
+
+void FlacEncoder::encode_frame(size_t size, std::vector<uint8_t> &output) {
+    std::vector<Subframe> subframes;
+    std::vector<const int32_t *> channels;
+    // 0から7は独立したチャンネル数-1、8はleft/side
+    int channel_assignment = m_num_channels - 1;
+
+    std::vector<int32_t> side;
+    if (m_num_channels == 2) {
+        // ステレオは左右の差分を使った方が小さくなることが多い(モノラルの複製では差分が無音になる)
+        side.resize(size);
+        for (size_t i = 0; i < size; i++) side[i] = m_pending[0][i] - m_pending[1][i];
+        Subframe left = analyze_subframe(m_pending[0].data(), size, m_bits_per_sample);
+        Subframe right = analyze_subframe(m_pending[1].data(), size, m_bits_per_sample);
+        Subframe side_subframe = analyze_subframe(side.data(), size, m_bits_per_sample + 1);
+        if (side_subframe.bits < right.bits) {
+            channel_assignment = 8;
+            subframes.push_back(left);
+            subframes.push_back(side_subframe);
+            channels.push_back(m_pending[0].data());
+            channels.push_back(side.data());
+        } else {
+            subframes.push_back(left);
+            subframes.push_back(right);
+            channels.push_back(m_pending[0].data());
+            channels.push_back(m_pending[1].data());
+        }
+    } else {
+        for (int channel = 0; channel < m_num_channels; channel++) {
+            subframes.push_back(analyze_subframe(m_pending[channel].data(), size, m_bits_per_sample));
+            channels.push_back(m_pending[channel].data());
+        }
+    }
+
+    size_t frame_start = output.size();
+    int rate_code = sample_rate_code(m_sampling_rate);
+    output.push_back(0xff);
+    output.push_back(0xf8); // 同期コード、固定ブロックサイズ
+    output.push_back((uint8_t)((0x7 << 4) | rate_code)); // ブロックサイズは末尾に16bitで書く
+    output.push_back((uint8_t)((channel_assignment << 4) | ((m_bits_per_sample == 16 ? 0x4 : 0x6) << 1)));
+    write_frame_number(output, m_frame_number);
+    output.push_back((uint8_t)((size - 1) >> 8));
+    output.push_back((uint8_t)((size - 1) & 0xff));
+    if (rate_code == 13) {
+        output.push_back((uint8_t)(m_sampling_rate >> 8));
+        output.push_back((uint8_t)(m_sampling_rate & 0xff));
+    } else if (rate_code == 14) {
+        output.push_back((uint8_t)((m_sampling_rate / 10) >> 8));
+        output.push_back((uint8_t)((m_sampling_rate / 10) & 0xff));
+    }
+    output.push_back(crc8(output.data() + frame_start, output.size() - frame_start));
+
+    BitWriter writer(output);
+    for (size_t i = 0; i < subframes.size(); i++) write_subframe(writer, subframes[i], channels[i], size);
+    writer.align();
+
+    uint16_t crc = crc16(output.data() + frame_start, output.size() - frame_start);
+    output.push_back((uint8_t)(crc >> 8));
+    output.push_back((uint8_t)(crc & 0xff));
+
+    for (std::vector<int32_t> &pending : m_pending) pending.erase(pending.begin(), pending.begin() + size);
+    m_frame_number++;
+}
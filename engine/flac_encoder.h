@@ -0,0 +1,34 @@
+#ifndef FLAC_ENCODER_H
+#define FLAC_ENCODER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// 外部ライブラリを使わないFLACエンコーダ
+// 固定予測とLPCのうち符号量が少ない方を選び、残差はライス符号で表す
+// header()の後にencode()を繰り返し呼ぶと、ブロックが埋まるたびにフレームを出力する
+class FlacEncoder {
+public:
+    FlacEncoder(int num_channels, int sampling_rate, int bits_per_sample = 16, int block_size = 4096);
+
+    // fLaCマーカーとSTREAMINFO。total_samplesが0の場合は長さ不明として扱われる
+    void header(uint64_t total_samples, std::vector<uint8_t> &output) const;
+    // インターリーブされたframes個分のサンプルを追加し、埋まったブロックをフレームとして出力する
+    void encode(const int32_t *samples, size_t frames, std::vector<uint8_t> &output);
+    // 残りのサンプルを最後のフレームとして出力する
+    void finish(std::vector<uint8_t> &output);
+
+private:
+    int m_num_channels;
+    int m_sampling_rate;
+    int m_bits_per_sample;
+    int m_block_size;
+    uint64_t m_frame_number;
+    // チャンネルごとの、まだフレームにしていないサンプル
+    std::vector<std::vector<int32_t>> m_pending;
+
+    void encode_frame(size_t size, std::vector<uint8_t> &output);
+};
+
+#endif // FLAC_ENCODER_H
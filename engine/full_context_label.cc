@@ -1,6 +1,7 @@
 #include <regex>
 
 #include "full_context_label.h"
+#include "stage_timer.h"
 
 std::string string_feature_by_regex(std::string pattern, std::string label) {
     std::regex re(pattern);
@@ -239,7 +240,10 @@ const std::vector<std::string> Utterance::labels() {
 
 Utterance extract_full_context_label(OpenJTalk *openjtalk, std::string text) {
     std::vector<std::string> labels = openjtalk->extract_fullcontext(text);
+    StageTimer timer;
     std::vector<Phoneme *> phonemes;
     for (std::string label : labels) phonemes.push_back(Phoneme::from_label(label));
-    return Utterance::from_phonemes(phonemes);
+    Utterance utterance = Utterance::from_phonemes(phonemes);
+    timer.record(LATENCY_LABEL);
+    return utterance;
 }
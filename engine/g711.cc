@@ -0,0 +1,96 @@
+#include <array>
+
+#include "g711.h"
+#include "pcm_kernel.h"
+#include "wave_resampler.h"
+
+// 間引きと圧伸をまとめて行う単位。キャッシュに収まる大きさにする
+constexpr size_t G711_CHUNK_SIZE = 1024;
+
+static uint8_t compute_mulaw(int16_t sample) {
+    // 14bitの絶対値(負の値は1の補数)
+    int16_t magnitude = sample < 0 ? (int16_t)((~sample) >> 2) : (int16_t)(sample >> 2);
+    magnitude += 33;
+    if (magnitude > 0x1fff) magnitude = 0x1fff;
+
+    int segment = 1;
+    for (int i = magnitude >> 6; i != 0; i >>= 1) segment++;
+
+    int high_nibble = 0x8 - segment;
+    int low_nibble = 0xf - ((magnitude >> segment) & 0xf);
+    uint8_t value = (uint8_t)((high_nibble << 4) | low_nibble);
+    if (sample >= 0) value |= 0x80;
+    return value;
+}
+
+static uint8_t compute_alaw(int16_t sample) {
+    // 12bitの絶対値(負の値は1の補数)
+    int16_t magnitude = sample < 0 ? (int16_t)((~sample) >> 4) : (int16_t)(sample >> 4);
+    if (magnitude > 15) {
+        int exponent = 1;
+        while (magnitude > 16 + 15) {
+            magnitude >>= 1;
+            exponent++;
+        }
+        magnitude -= 16;
+        magnitude += exponent << 4;
+    }
+    if (sample >= 0) magnitude |= 0x80;
+    return (uint8_t)(magnitude ^ 0x55);
+}
+
+// μ-lawは上位14bit、A-lawは上位12bitだけで値が決まる
+static const std::array<uint8_t, 1 << 14> &mulaw_table() {
+    static const std::array<uint8_t, 1 << 14> table = []() {
+        std::array<uint8_t, 1 << 14> table{};
+        for (int i = 0; i < (1 << 14); i++) table[i] = compute_mulaw((int16_t)((i - (1 << 13)) * 4));
+        return table;
+    }();
+    return table;
+}
+
+static const std::array<uint8_t, 1 << 12> &alaw_table() {
+    static const std::array<uint8_t, 1 << 12> table = []() {
+        std::array<uint8_t, 1 << 12> table{};
+        for (int i = 0; i < (1 << 12); i++) table[i] = compute_alaw((int16_t)((i - (1 << 11)) * 16));
+        return table;
+    }();
+    return table;
+}
+
+uint8_t linear_to_mulaw(int16_t sample) {
+    return mulaw_table()[(sample >> 2) + (1 << 13)];
+}
+
+uint8_t linear_to_alaw(int16_t sample) {
+    return alaw_table()[(sample >> 4) + (1 << 11)];
+}
+
+void encode_g711(const float *wave, size_t size, int input_rate, float gain, G711Law law, std::vector<uint8_t> &output) {
+    const std::array<uint8_t, 1 << 14> &mulaw = mulaw_table();
+    const std::array<uint8_t, 1 << 12> &alaw = alaw_table();
+
+    WaveResampler resampler(input_rate, G711_SAMPLING_RATE);
+    std::vector<float> decimated;
+    std::vector<int16_t> pcm;
+    output.reserve(output.size() + (size_t)((double)size * G711_SAMPLING_RATE / input_rate) + 1);
+
+    auto compand = [&]() {
+        pcm.resize(decimated.size());
+        convert_to_int16(decimated.data(), decimated.size(), gain, 1, pcm.data());
+        if (law == G711_MULAW) {
+            for (int16_t sample : pcm) output.push_back(mulaw[(sample >> 2) + (1 << 13)]);
+        } else {
+            for (int16_t sample : pcm) output.push_back(alaw[(sample >> 4) + (1 << 11)]);
+        }
+        decimated.clear();
+    };
+
+    for (size_t i = 0; i < size; i += G711_CHUNK_SIZE) {
+        size_t chunk = size - i < G711_CHUNK_SIZE ? size - i : G711_CHUNK_SIZE;
+        resampler.process(wave + i, chunk, decimated);
+        compand();
+    }
+    resampler.flush(decimated);
+    compand();
+}
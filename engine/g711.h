@@ -0,0 +1,23 @@
+#ifndef G711_H
+#define G711_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+constexpr int G711_SAMPLING_RATE = 8000;
+
+enum G711Law {
+    G711_MULAW,
+    G711_ALAW,
+};
+
+// ITU-T G.191のリファレンス実装と同じ変換を、表を引いて行う
+uint8_t linear_to_mulaw(int16_t sample);
+uint8_t linear_to_alaw(int16_t sample);
+
+// input_rateの波形を8kHzに間引きながら、利得の調整と圧伸を一度に行う
+// 出力はヘッダなしの1サンプル1byteで、RTPのペイロードにそのまま使える
+void encode_g711(const float *wave, size_t size, int input_rate, float gain, G711Law law, std::vector<uint8_t> &output);
+
+#endif // G711_H
@@ -50,23 +50,6 @@ static const std::map<std::string, Napi::Object> text2mora_with_unvoice(Napi::En
     return text2mora_with_unvoice;
 }
 
-std::string extract_one_character(const std::string& text, size_t pos, size_t& size) {
-    // UTF-8の文字は可変長なので、leadの値で長さを判別する
-    unsigned char lead = text[pos];
-
-    if (lead < 0x80) {
-        size = 1;
-    } else if (lead < 0xE0) {
-        size = 2;
-    } else if (lead < 0xF0) {
-        size = 3;
-    } else {
-        size = 4;
-    }
-
-    return text.substr(pos, size);
-}
-
 Napi::Object text_to_accent_phrase(Napi::Env env, std::string phrase) {
     int accent_index = 0;
 
@@ -17,7 +17,6 @@ const std::string PAUSE_DELIMITER = "、";
 const std::string WIDE_INTERROGATION_MARK = "？";
 
 static const std::map<std::string, Napi::Object> text2mora_with_unvoice(Napi::Env env);
-std::string extract_one_character(const std::string& text, size_t pos, size_t& size);
 
 Napi::Object text_to_accent_phrase(Napi::Env env, std::string phrase);
 Napi::Array parse_kana(Napi::Env env, std::string text);
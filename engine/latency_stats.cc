@@ -0,0 +1,100 @@
+#include "latency_stats.h"
+
+static const char *latency_stage_names[LATENCY_STAGE_COUNT] = {
+    "text2mecab",
+    "mecab",
+    "njd",
+    "label",
+    "yukarin_s",
+    "yukarin_sa",
+    "frames",
+    "decode",
+    "resample",
+    "trim",
+    "normalize",
+    "encode",
+};
+
+const char *latency_stage_name(LatencyStage stage) {
+    return latency_stage_names[stage];
+}
+
+static const char *request_kind_names[REQUEST_KIND_COUNT] = {
+    "audio_query",
+    "accent_phrases",
+    "mora_data",
+    "mora_length",
+    "mora_pitch",
+    "synthesis",
+    "synthesis_with_timing",
+    "synthesis_concat",
+};
+
+const char *request_kind_name(RequestKind kind) {
+    return request_kind_names[kind];
+}
+
+static size_t bucket_index(uint64_t ns) {
+    uint64_t us = ns / 1000;
+    size_t index = 0;
+    while (us > 0 && index < LATENCY_BUCKET_COUNT - 1) {
+        us >>= 1;
+        index++;
+    }
+    return index;
+}
+
+double LatencySnapshot::percentile(double p) const {
+    if (count == 0) return 0.0;
+    uint64_t rank = (uint64_t)(p * (double)count);
+    if (rank >= count) rank = count - 1;
+    uint64_t seen = 0;
+    for (size_t i = 0; i < buckets.size(); i++) {
+        seen += buckets[i];
+        if (seen > rank) {
+            double upper_ms = (double)((uint64_t)1 << i) / 1000.0;
+            double max_ms = (double)max_ns / 1e6;
+            return upper_ms < max_ms ? upper_ms : max_ms;
+        }
+    }
+    return (double)max_ns / 1e6;
+}
+
+LatencyHistogram::LatencyHistogram() {
+    for (std::atomic<uint64_t> &bucket : m_buckets) bucket.store(0, std::memory_order_relaxed);
+    m_total_ns.store(0, std::memory_order_relaxed);
+    m_max_ns.store(0, std::memory_order_relaxed);
+}
+
+void LatencyHistogram::add(uint64_t ns) {
+    m_buckets[bucket_index(ns)].fetch_add(1, std::memory_order_relaxed);
+    m_total_ns.fetch_add(ns, std::memory_order_relaxed);
+    uint64_t max_ns = m_max_ns.load(std::memory_order_relaxed);
+    while (ns > max_ns && !m_max_ns.compare_exchange_weak(max_ns, ns, std::memory_order_relaxed)) {
+    }
+}
+
+LatencySnapshot LatencyHistogram::snapshot(bool reset) {
+    LatencySnapshot snapshot;
+    snapshot.buckets.resize(LATENCY_BUCKET_COUNT);
+    // 件数はバケットの合計から求め、ヒストグラムと食い違わないようにする
+    snapshot.count = 0;
+    for (size_t i = 0; i < LATENCY_BUCKET_COUNT; i++) {
+        snapshot.buckets[i] = reset ? m_buckets[i].exchange(0, std::memory_order_relaxed)
+                                    : m_buckets[i].load(std::memory_order_relaxed);
+        snapshot.count += snapshot.buckets[i];
+    }
+    if (reset) {
+        snapshot.total_ns = m_total_ns.exchange(0, std::memory_order_relaxed);
+        snapshot.max_ns = m_max_ns.exchange(0, std::memory_order_relaxed);
+    } else {
+        snapshot.total_ns = m_total_ns.load(std::memory_order_relaxed);
+        snapshot.max_ns = m_max_ns.load(std::memory_order_relaxed);
+    }
+    return snapshot;
+}
+
+LatencyStats &latency_stats() {
+    static LatencyStats stats;
+    return stats;
+}
@@ -0,0 +1,82 @@
+#ifndef LATENCY_STATS_H
+#define LATENCY_STATS_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+enum LatencyStage {
+    LATENCY_TEXT2MECAB,
+    LATENCY_MECAB,
+    LATENCY_NJD,
+    LATENCY_LABEL,
+    LATENCY_YUKARIN_S,
+    LATENCY_YUKARIN_SA,
+    LATENCY_FRAMES,
+    LATENCY_DECODE,
+    LATENCY_RESAMPLE,
+    LATENCY_TRIM,
+    LATENCY_NORMALIZE,
+    LATENCY_ENCODE,
+    LATENCY_STAGE_COUNT,
+};
+
+const char *latency_stage_name(LatencyStage stage);
+
+// 集計を分けるリクエストの種類(バインディングのメソッド)
+enum RequestKind {
+    REQUEST_AUDIO_QUERY,
+    REQUEST_ACCENT_PHRASES,
+    REQUEST_MORA_DATA,
+    REQUEST_MORA_LENGTH,
+    REQUEST_MORA_PITCH,
+    REQUEST_SYNTHESIS,
+    REQUEST_SYNTHESIS_WITH_TIMING,
+    REQUEST_SYNTHESIS_CONCAT,
+    REQUEST_KIND_COUNT,
+};
+
+const char *request_kind_name(RequestKind kind);
+
+// バケットiには[2^(i-1), 2^i)マイクロ秒の記録が入る。バケット0は1マイクロ秒未満
+constexpr size_t LATENCY_BUCKET_COUNT = 32;
+
+struct LatencySnapshot {
+    uint64_t count;
+    uint64_t total_ns;
+    uint64_t max_ns;
+    std::vector<uint64_t> buckets;
+
+    // バケットの上端で近似した、割合p(0から1)の位置の値(ミリ秒)
+    double percentile(double p) const;
+};
+
+// 複数のスレッドから、ロックを取らずに記録できるヒストグラム
+class LatencyHistogram {
+public:
+    LatencyHistogram();
+
+    void add(uint64_t ns);
+    // resetがtrueの場合、読み出した分を0に戻す。読み出しの途中の記録は次の読み出しに含まれる
+    LatencySnapshot snapshot(bool reset);
+
+private:
+    std::atomic<uint64_t> m_buckets[LATENCY_BUCKET_COUNT];
+    std::atomic<uint64_t> m_total_ns;
+    std::atomic<uint64_t> m_max_ns;
+};
+
+// 段階ごとのヒストグラム。プロセス全体で1つをlatency_stats()で共有する
+class LatencyStats {
+public:
+    void add(LatencyStage stage, uint64_t ns) { m_histograms[stage].add(ns); }
+    LatencySnapshot snapshot(LatencyStage stage, bool reset) { return m_histograms[stage].snapshot(reset); }
+
+private:
+    LatencyHistogram m_histograms[LATENCY_STAGE_COUNT];
+};
+
+LatencyStats &latency_stats();
+
+#endif // LATENCY_STATS_H
@@ -0,0 +1,110 @@
+#include <algorithm>
+
+#include "memory_stats.h"
+
+void MemoryCounter::add(const MemoryUsage &usage) {
+    m_count.fetch_add(1, std::memory_order_relaxed);
+    m_allocated_bytes.fetch_add((uint64_t)std::max<int64_t>(usage.allocated_bytes, 0), std::memory_order_relaxed);
+    uint64_t peak = (uint64_t)std::max<int64_t>(usage.peak_bytes, 0);
+    uint64_t max_peak = m_peak_bytes.load(std::memory_order_relaxed);
+    while (peak > max_peak && !m_peak_bytes.compare_exchange_weak(max_peak, peak, std::memory_order_relaxed)) {
+    }
+}
+
+MemorySnapshot MemoryCounter::snapshot(bool reset) {
+    MemorySnapshot snapshot;
+    if (reset) {
+        snapshot.count = m_count.exchange(0, std::memory_order_relaxed);
+        snapshot.allocated_bytes = m_allocated_bytes.exchange(0, std::memory_order_relaxed);
+        snapshot.peak_bytes = m_peak_bytes.exchange(0, std::memory_order_relaxed);
+    } else {
+        snapshot.count = m_count.load(std::memory_order_relaxed);
+        snapshot.allocated_bytes = m_allocated_bytes.load(std::memory_order_relaxed);
+        snapshot.peak_bytes = m_peak_bytes.load(std::memory_order_relaxed);
+    }
+    return snapshot;
+}
+
+MemoryStats &memory_stats() {
+    static MemoryStats stats;
+    return stats;
+}
+
+#ifdef ENGINE_MEMORY_ACCOUNTING
+
+#include <cstdlib>
+#include <new>
+
+#if defined(_WIN32) || defined(_WIN64)
+#include <malloc.h>
+#define allocated_size(ptr) _msize(ptr)
+#elif defined(__APPLE__)
+#include <malloc/malloc.h>
+#define allocated_size(ptr) malloc_size(ptr)
+#else
+#include <malloc.h>
+#define allocated_size(ptr) malloc_usable_size(ptr)
+#endif
+
+// 確保した領域の先頭に大きさを書き込まず、mallocの管理情報から大きさを得る
+// これにより、libstdc++やNode.jsが確保した領域をここで解放しても(その逆も)壊れない
+// その場合の解放分も数えるため、liveは負になることがある
+struct ThreadMemory {
+    int64_t allocated;
+    int64_t live;
+    int64_t peak;
+};
+
+// 定数で初期化できる型にして、operator newの中でもスレッドローカル変数の初期化が走らないようにする
+static thread_local ThreadMemory thread_memory = { 0, 0, 0 };
+
+static void *allocate(size_t size, bool nothrow) {
+    void *ptr = std::malloc(size == 0 ? 1 : size);
+    if (ptr == nullptr) {
+        if (nothrow) return nullptr;
+        throw std::bad_alloc();
+    }
+    int64_t bytes = (int64_t)allocated_size(ptr);
+    thread_memory.allocated += bytes;
+    thread_memory.live += bytes;
+    if (thread_memory.live > thread_memory.peak) thread_memory.peak = thread_memory.live;
+    return ptr;
+}
+
+static void deallocate(void *ptr) {
+    if (ptr == nullptr) return;
+    thread_memory.live -= (int64_t)allocated_size(ptr);
+    std::free(ptr);
+}
+
+void *operator new(size_t size) { return allocate(size, false); }
+void *operator new[](size_t size) { return allocate(size, false); }
+void *operator new(size_t size, const std::nothrow_t &) noexcept { return allocate(size, true); }
+void *operator new[](size_t size, const std::nothrow_t &) noexcept { return allocate(size, true); }
+void operator delete(void *ptr) noexcept { deallocate(ptr); }
+void operator delete[](void *ptr) noexcept { deallocate(ptr); }
+void operator delete(void *ptr, size_t) noexcept { deallocate(ptr); }
+void operator delete[](void *ptr, size_t) noexcept { deallocate(ptr); }
+void operator delete(void *ptr, const std::nothrow_t &) noexcept { deallocate(ptr); }
+void operator delete[](void *ptr, const std::nothrow_t &) noexcept { deallocate(ptr); }
+
+void MemoryScope::start() {
+    m_active = true;
+    m_allocated = thread_memory.allocated;
+    m_live = thread_memory.live;
+    // 外側の区間の最大値を退避し、この区間の最大値を開始時点から数え直す
+    m_saved_peak = thread_memory.peak;
+    thread_memory.peak = thread_memory.live;
+}
+
+MemoryUsage MemoryScope::finish() {
+    MemoryUsage usage;
+    if (!m_active) return usage;
+    m_active = false;
+    usage.allocated_bytes = thread_memory.allocated - m_allocated;
+    usage.peak_bytes = thread_memory.peak - m_live;
+    thread_memory.peak = std::max(thread_memory.peak, m_saved_peak);
+    return usage;
+}
+
+#endif // ENGINE_MEMORY_ACCOUNTING
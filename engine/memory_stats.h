@@ -0,0 +1,95 @@
+#ifndef MEMORY_STATS_H
+#define MEMORY_STATS_H
+
+#include <atomic>
+#include <cstdint>
+
+#include "latency_stats.h"
+
+// ENGINE_MEMORY_ACCOUNTING を定義してビルドした場合(node-gyp rebuild --memory_accounting=true)のみ、
+// グローバルなoperator new/deleteを置き換えて、スレッドごとに確保したbyte数を数える
+// 定義しない場合、MemoryScopeは何もせず、集計は常に0になる
+#ifdef ENGINE_MEMORY_ACCOUNTING
+constexpr bool memory_accounting_enabled = true;
+#else
+constexpr bool memory_accounting_enabled = false;
+#endif
+
+struct MemoryUsage {
+    // 区間の中で確保したbyte数の合計
+    int64_t allocated_bytes = 0;
+    // 区間の開始時点から増えた、確保したままのbyte数の最大値
+    int64_t peak_bytes = 0;
+};
+
+struct MemorySnapshot {
+    uint64_t count;
+    uint64_t allocated_bytes;
+    uint64_t peak_bytes;
+};
+
+// 区間ごとの集計。ロックを取らずに記録できる
+class MemoryCounter {
+public:
+    MemoryCounter() : m_count(0), m_allocated_bytes(0), m_peak_bytes(0) {}
+
+    void add(const MemoryUsage &usage);
+    MemorySnapshot snapshot(bool reset);
+
+private:
+    std::atomic<uint64_t> m_count;
+    std::atomic<uint64_t> m_allocated_bytes;
+    // 1回の区間でのpeak_bytesの最大値
+    std::atomic<uint64_t> m_peak_bytes;
+};
+
+// 段階ごと、リクエストの種類ごとの集計。プロセス全体で1つをmemory_stats()で共有する
+class MemoryStats {
+public:
+    void add(LatencyStage stage, const MemoryUsage &usage) { m_stages[stage].add(usage); }
+    void add(RequestKind kind, const MemoryUsage &usage) { m_requests[kind].add(usage); }
+    MemorySnapshot snapshot(LatencyStage stage, bool reset) { return m_stages[stage].snapshot(reset); }
+    MemorySnapshot snapshot(RequestKind kind, bool reset) { return m_requests[kind].snapshot(reset); }
+
+private:
+    MemoryCounter m_stages[LATENCY_STAGE_COUNT];
+    MemoryCounter m_requests[REQUEST_KIND_COUNT];
+};
+
+MemoryStats &memory_stats();
+
+#ifdef ENGINE_MEMORY_ACCOUNTING
+// 現在のスレッドで、作成からfinish()までに確保したbyte数を数える。入れ子にできる
+class MemoryScope {
+public:
+    MemoryScope() { start(); }
+    ~MemoryScope() { finish(); }
+    MemoryScope(const MemoryScope &) = delete;
+    MemoryScope &operator=(const MemoryScope &) = delete;
+
+    // 区間を閉じて結果を返す。2回目以降は何もせず空の結果を返す
+    MemoryUsage finish();
+    // 区間を閉じて、新しい区間を始める
+    MemoryUsage restart() {
+        MemoryUsage usage = finish();
+        start();
+        return usage;
+    }
+
+private:
+    bool m_active;
+    int64_t m_allocated;
+    int64_t m_live;
+    int64_t m_saved_peak;
+
+    void start();
+};
+#else
+class MemoryScope {
+public:
+    MemoryUsage finish() { return MemoryUsage(); }
+    MemoryUsage restart() { return MemoryUsage(); }
+};
+#endif
+
+#endif // MEMORY_STATS_H
@@ -1,3 +1,5 @@
+#include <unordered_set>
+
 #include "mora_list.h"
 
 std::string mora2text(std::string mora) {
@@ -16,3 +18,34 @@ std::string mora2text(std::string mora) {
     }
     return text;
 }
+
+static std::unordered_set<std::string> create_mora_text_set() {
+    std::unordered_set<std::string> mora_text_set;
+    for (size_t i = 0; i < mora_list_minimum.size(); i += 3) {
+        mora_text_set.insert(mora_list_minimum[i]);
+    }
+    return mora_text_set;
+}
+
+// カタカナ表記がモーラとして存在するかを判定する
+bool is_mora_text(const std::string &text) {
+    static const std::unordered_set<std::string> mora_text_set = create_mora_text_set();
+    return mora_text_set.find(text) != mora_text_set.end();
+}
+
+std::string extract_one_character(const std::string& text, size_t pos, size_t& size) {
+    // UTF-8の文字は可変長なので、leadの値で長さを判別する
+    unsigned char lead = text[pos];
+
+    if (lead < 0x80) {
+        size = 1;
+    } else if (lead < 0xE0) {
+        size = 2;
+    } else if (lead < 0xF0) {
+        size = 3;
+    } else {
+        size = 4;
+    }
+
+    return text.substr(pos, size);
+}
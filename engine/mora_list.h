@@ -196,5 +196,7 @@ static const std::vector<std::string> mora_list_minimum = {
 };
 
 std::string mora2text(std::string mora);
+bool is_mora_text(const std::string &text);
+std::string extract_one_character(const std::string& text, size_t pos, size_t& size);
 
 #endif // MORA_LIST_H
@@ -1,6 +1,12 @@
+#include <cstdio>
 #include <cstring>
+#include <fstream>
 
 #include "openjtalk.h"
+#include "probes.h"
+#include "stage_timer.h"
+#include "tracer.h"
+#include "uuid_v4.h"
 
 #include <mecab2njd.h>
 #include <njd2jpcommon.h>
@@ -12,6 +18,26 @@
 #include <njd_set_unvoiced_vowel.h>
 #include <text2mecab.h>
 
+#if defined(_WIN32) || defined(_WIN64)
+#include <windows.h>
+#endif
+
+// MeCabはargvの文字列を書き換えないので、argsが生きている間はそのまま渡せる
+static std::vector<char *> to_argv(std::vector<std::string> &args) {
+    std::vector<char *> argv;
+    for (std::string &arg : args) argv.push_back(&arg[0]);
+    return argv;
+}
+
+// 同一ディレクトリ内でのrenameはアトミックに置き換わる
+bool replace_file(const std::string &from, const std::string &to) {
+#if defined(_WIN32) || defined(_WIN64)
+    return MoveFileExA(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+    return std::rename(from.c_str(), to.c_str()) == 0;
+#endif
+}
+
 BOOL Mecab_load_ex(Mecab* m, const char* dicdir, const char* userdic)
 {
     int i;
@@ -26,7 +52,8 @@ BOOL Mecab_load_ex(Mecab* m, const char* dicdir, const char* userdic)
 
     Mecab_clear(m);
 
-    std::vector<char *> argv = { strdup("mecab"), strdup("-d"), strdup(dicdir), strdup("-u"), strdup(userdic) };
+    std::vector<std::string> args = { "mecab", "-d", dicdir, "-u", userdic };
+    std::vector<char *> argv = to_argv(args);
 
     MeCab::Model* model = MeCab::createModel(argv.size(), argv.data());
 
@@ -59,14 +86,52 @@ BOOL Mecab_load_ex(Mecab* m, const char* dicdir, const char* userdic)
 
 
 void create_user_dict(std::string dn_mecab, std::string path, std::string out_path) {
-    std::vector<char*> argv = { strdup("mecab-dict-index"), strdup("-d"), strdup(dn_mecab.c_str()), strdup("-u"), strdup(out_path.c_str()), strdup("-f"), strdup("utf-8"), strdup("-t"), strdup("utf-8"), strdup(path.c_str()) };
-    mecab_dict_index(argv.size(), argv.data());
+    std::vector<std::string> args = {
+        "mecab-dict-index", "-d", dn_mecab, "-u", out_path, "-f", "utf-8", "-t", "utf-8", path
+    };
+    std::vector<char *> argv = to_argv(args);
+    if (mecab_dict_index(argv.size(), argv.data()) != 0) {
+        throw std::runtime_error("failed to compile user dictionary");
+    }
+}
+
+std::string compile_user_dict(std::string dn_mecab, const std::vector<std::string> &csv_rows, std::string out_path) {
+    TraceScope trace("compile_user_dict");
+    // MeCabの辞書コンパイラはファイルからしか読み込めないため、CSVは出力先と同じディレクトリに置く
+    // ファイル名はUUIDで一意にし、tmpnamのような他のプロセスとの競合が起きないようにする
+    std::string staging_path = out_path + "." + uuid_v4();
+    std::string csv_path = staging_path + ".csv";
+    std::string compiled_dict_path = staging_path + ".dic";
+
+    std::ofstream csv_file(csv_path, std::ios::out | std::ios::trunc | std::ios::binary);
+    if (!csv_file) {
+        throw std::runtime_error("failed to create user dictionary source");
+    }
+    for (const std::string &row : csv_rows) {
+        csv_file << row << '\n';
+    }
+    csv_file.close();
+
+    try {
+        create_user_dict(dn_mecab, csv_path, compiled_dict_path);
+    } catch (std::exception&) {
+        std::remove(csv_path.c_str());
+        std::remove(compiled_dict_path.c_str());
+        throw;
+    }
+    std::remove(csv_path.c_str());
+    return compiled_dict_path;
 }
 
 std::vector<std::string> OpenJTalk::extract_fullcontext(std::string text) {
+    ENGINE_PROBE1(extract_fullcontext_entry, text.size());
+    std::lock_guard<std::mutex> lock(m_mecab_mutex);
+    StageTimer timer;
     char buff[8192];
     text2mecab(buff, text.c_str());
+    timer.record(LATENCY_TEXT2MECAB);
     Mecab_analysis(mecab, buff);
+    timer.record(LATENCY_MECAB);
     mecab2njd(njd, Mecab_get_feature(mecab), Mecab_get_size(mecab));
     njd_set_pronunciation(njd);
     njd_set_digit(njd);
@@ -76,6 +141,7 @@ std::vector<std::string> OpenJTalk::extract_fullcontext(std::string text) {
     njd_set_long_vowel(njd);
     njd2jpcommon(jpcommon, njd);
     JPCommon_make_label(jpcommon);
+    timer.record(LATENCY_NJD);
 
     std::vector<std::string> labels;
 
@@ -89,6 +155,7 @@ std::vector<std::string> OpenJTalk::extract_fullcontext(std::string text) {
     NJD_refresh(njd);
     Mecab_refresh(mecab);
 
+    ENGINE_PROBE2(extract_fullcontext_return, text.size(), labels.size());
     return labels;
 }
 
@@ -111,6 +178,62 @@ void OpenJTalk::load_ex(std::string dn_mecab, std::string user_mecab) {
     }
 }
 
+void OpenJTalk::install_user_dict(std::string compiled_dict_path) {
+    TraceScope trace("install_user_dict");
+    std::lock_guard<std::mutex> lock(m_mecab_mutex);
+    // Windowsではマップ中のファイルを置き換えられないので、先に辞書を解放する
+    Mecab_clear(mecab);
+    // 新しい辞書を読み込めなかった場合に戻せるよう、今の辞書は読み込めるまで退避しておく
+    bool had_user_mecab = m_has_user_mecab;
+    std::string backup_path = user_mecab + ".bak";
+    if (had_user_mecab && !replace_file(user_mecab, backup_path)) {
+        if (!compiled_dict_path.empty()) std::remove(compiled_dict_path.c_str());
+        restore_mecab();
+        throw std::runtime_error("failed to install user dictionary");
+    }
+
+    bool installed = true;
+    if (compiled_dict_path.empty()) {
+        m_has_user_mecab = false;
+    } else if (replace_file(compiled_dict_path, user_mecab)) {
+        m_has_user_mecab = true;
+    } else {
+        std::remove(compiled_dict_path.c_str());
+        installed = false;
+    }
+    if (installed && reload_mecab()) {
+        if (had_user_mecab) std::remove(backup_path.c_str());
+        return;
+    }
+
+    // 読み込めなかった辞書を捨てて、以前の辞書に戻す
+    if (had_user_mecab) {
+        replace_file(backup_path, user_mecab);
+    } else if (m_has_user_mecab) {
+        std::remove(user_mecab.c_str());
+    }
+    m_has_user_mecab = had_user_mecab;
+    restore_mecab();
+    throw std::runtime_error("failed to install user dictionary");
+}
+
+// MeCabのuserdicはカンマ区切りで複数の辞書を受け取るので、既定の辞書とユーザー辞書を1つのTaggerで読み込む
+bool OpenJTalk::reload_mecab() {
+    std::string userdic = default_mecab;
+    if (m_has_user_mecab) {
+        if (!userdic.empty()) userdic += ",";
+        userdic += user_mecab;
+    }
+    return Mecab_load_ex(mecab, dn_mecab.c_str(), userdic.c_str()) == 1;
+}
+
+// NJDとJPCommonはそのままに、読み込める辞書まで順に戻してMeCabを使える状態に保つ
+void OpenJTalk::restore_mecab() {
+    if (reload_mecab()) return;
+    m_has_user_mecab = false;
+    if (reload_mecab()) return;
+    Mecab_load(mecab, dn_mecab.c_str());
+}
 
 void OpenJTalk::clear() {
     Mecab_clear(mecab);
@@ -1,6 +1,7 @@
 #ifndef OPENJTALK_H
 #define OPENJTALK_H
 
+#include <mutex>
 #include <stdexcept>
 #include <string>
 #include <vector>
@@ -10,7 +11,9 @@
 #include <jpcommon.h>
 
 BOOL Mecab_load_ex(Mecab* m, const char* dicdir, const char* userdic);
+bool replace_file(const std::string &from, const std::string &to);
 void create_user_dict(std::string dn_mecab, std::string path, std::string out_path);
+std::string compile_user_dict(std::string dn_mecab, const std::vector<std::string> &csv_rows, std::string out_path);
 
 class OpenJTalk {
 public:
@@ -18,9 +21,13 @@ public:
     NJD* njd;
     JPCommon* jpcommon;
     std::string dn_mecab;
+    // 全ての名前空間で共有する、既定の辞書(default.csv)をコンパイルしたもの。空の場合は使わない
+    std::string default_mecab;
+    // この名前空間のユーザー辞書の単語のみをコンパイルしたもの
     std::string user_mecab;
-    std::string default_dict_path;
     std::string user_dict_path;
+    // ユーザー辞書(user_dict_path)の読み込みから書き込みまでを直列化する
+    std::mutex user_dict_mutex;
 
     OpenJTalk() {
         mecab = new Mecab();
@@ -48,7 +55,19 @@ public:
 
     void load(std::string dn_mecab);
     void load_ex(std::string dn_mecab, std::string user_mecab);
+    // コンパイルしたユーザー辞書をuser_mecabに置き、既定の辞書と一緒に読み込み直す
+    // compiled_dict_pathが空の場合は、単語がないものとして既定の辞書のみを読み込む
+    // 読み込めなかった場合は以前の辞書に戻してから例外を投げる
+    void install_user_dict(std::string compiled_dict_path);
     void clear();
+
+private:
+    // 解析中にユーザー辞書が差し替えられないようにする
+    std::mutex m_mecab_mutex;
+    bool m_has_user_mecab = false;
+
+    bool reload_mecab();
+    void restore_mecab();
 };
 
 #endif // OPENJTALK_H
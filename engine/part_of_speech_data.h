@@ -1,154 +1,177 @@
 #ifndef PART_OF_SPEECH_DATA_H
 #define PART_OF_SPEECH_DATA_H
 
-#include "nlohmann/json.hpp"
+#include <array>
+#include <cstdint>
+#include <string>
 
-using json = nlohmann::json;
+constexpr int USER_DICT_MIN_PRIORITY = 0;
+constexpr int USER_DICT_MAX_PRIORITY = 10;
 
-int USER_DICT_MIN_PRIORITY = 0;
-int USER_DICT_MAX_PRIORITY = 10;
+typedef std::array<int, USER_DICT_MAX_PRIORITY - USER_DICT_MIN_PRIORITY + 1> CostCandidates;
 
-json part_of_speech_data = {
+struct PartOfSpeechDetail {
+    const char *word_type;
+    const char *part_of_speech;
+    const char *part_of_speech_detail_1;
+    const char *part_of_speech_detail_2;
+    const char *part_of_speech_detail_3;
+    int context_id;
+    // 優先度(USER_DICT_MAX_PRIORITY - index)に対応するコスト
+    CostCandidates cost_candidates;
+    std::array<const char *, 6> accent_associative_rules;
+    size_t accent_associative_rules_size;
+};
+
+static constexpr std::array<PartOfSpeechDetail, 5> part_of_speech_data = {{
     {
-        "PROPER_NOUN", {
-            { "part_of_speech", "名詞" }, 
-            { "part_of_speech_detail_1", "固有名詞" },
-            { "part_of_speech_detail_2", "一般" },
-            { "part_of_speech_detail_3", "*" },
-            { "context_id", 1348 },
-            { "cost_candidates", {
-                -988,
-                3488,
-                4768,
-                6048,
-                7328,
-                8609,
-                8734,
-                8859,
-                8984,
-                9110,
-                14176,
-            } },
-            { "accent_associative_rules", {
-                "*",
-                "C1",
-                "C2",
-                "C3",
-                "C4",
-                "C5",
-            } }
-        }
+        "PROPER_NOUN",
+        "名詞",
+        "固有名詞",
+        "一般",
+        "*",
+        1348,
+        {
+            -988,
+            3488,
+            4768,
+            6048,
+            7328,
+            8609,
+            8734,
+            8859,
+            8984,
+            9110,
+            14176,
+        },
+        { "*", "C1", "C2", "C3", "C4", "C5" },
+        6
     },
     {
-        "COMMON_NOUN", {
-            { "part_of_speech", "名詞" }, 
-            { "part_of_speech_detail_1", "一般" },
-            { "part_of_speech_detail_2", "*" },
-            { "part_of_speech_detail_3", "*" },
-            { "context_id", 1345 },
-            { "cost_candidates", {
-                -4445,
-                49,
-                1473,
-                2897,
-                4321,
-                5746,
-                6554,
-                7362,
-                8170,
-                8979,
-                15001,
-            } },
-            { "accent_associative_rules", {
-                "*",
-                "C1",
-                "C2",
-                "C3",
-                "C4",
-                "C5",
-            } }
-        }
+        "COMMON_NOUN",
+        "名詞",
+        "一般",
+        "*",
+        "*",
+        1345,
+        {
+            -4445,
+            49,
+            1473,
+            2897,
+            4321,
+            5746,
+            6554,
+            7362,
+            8170,
+            8979,
+            15001,
+        },
+        { "*", "C1", "C2", "C3", "C4", "C5" },
+        6
     },
     {
-        "VERB", {
-            { "part_of_speech", "動詞" }, 
-            { "part_of_speech_detail_1", "自立" },
-            { "part_of_speech_detail_2", "*" },
-            { "part_of_speech_detail_3", "*" },
-            { "context_id", 642 },
-            { "cost_candidates", {
-                3100,
-                6160,
-                6360,
-                6561,
-                6761,
-                6962,
-                7414,
-                7866,
-                8318,
-                8771,
-                13433,
-            } },
-            { "accent_associative_rules", {
-                "*",
-            } }
-        }
+        "VERB",
+        "動詞",
+        "自立",
+        "*",
+        "*",
+        642,
+        {
+            3100,
+            6160,
+            6360,
+            6561,
+            6761,
+            6962,
+            7414,
+            7866,
+            8318,
+            8771,
+            13433,
+        },
+        { "*" },
+        1
     },
     {
-        "ADJECTIVE", {
-            { "part_of_speech", "形容詞" }, 
-            { "part_of_speech_detail_1", "自立" },
-            { "part_of_speech_detail_2", "*" },
-            { "part_of_speech_detail_3", "*" },
-            { "context_id", 20 },
-            { "cost_candidates", {
-                1527,
-                3266,
-                3561,
-                3857,
-                4153,
-                4449,
-                5149,
-                5849,
-                6549,
-                7250,
-                10001,
-            } },
-            { "accent_associative_rules", {
-                "*",
-            } }
-        }
+        "ADJECTIVE",
+        "形容詞",
+        "自立",
+        "*",
+        "*",
+        20,
+        {
+            1527,
+            3266,
+            3561,
+            3857,
+            4153,
+            4449,
+            5149,
+            5849,
+            6549,
+            7250,
+            10001,
+        },
+        { "*" },
+        1
     },
     {
-        "SUFFIX", {
-            { "part_of_speech", "名詞" }, 
-            { "part_of_speech_detail_1", "接尾" },
-            { "part_of_speech_detail_2", "一般" },
-            { "part_of_speech_detail_3", "*" },
-            { "context_id", 1358 },
-            { "cost_candidates", {
-                4399,
-                5373,
-                6041,
-                6710,
-                7378,
-                8047,
-                9440,
-                10834,
-                12228,
-                13622,
-                15847,
-            } },
-            { "accent_associative_rules", {
-                "*",
-                "C1",
-                "C2",
-                "C3",
-                "C4",
-                "C5",
-            } }
-        }
+        "SUFFIX",
+        "名詞",
+        "接尾",
+        "一般",
+        "*",
+        1358,
+        {
+            4399,
+            5373,
+            6041,
+            6710,
+            7378,
+            8047,
+            9440,
+            10834,
+            12228,
+            13622,
+            15847,
+        },
+        { "*", "C1", "C2", "C3", "C4", "C5" },
+        6
     }
-};
+}};
+
+constexpr int max_part_of_speech_context_id() {
+    int max_context_id = 0;
+    for (const PartOfSpeechDetail &detail : part_of_speech_data) {
+        if (detail.context_id > max_context_id) max_context_id = detail.context_id;
+    }
+    return max_context_id;
+}
+
+// context_idからpart_of_speech_dataの添字を引くための表(該当しないものは-1)
+constexpr std::array<int8_t, max_part_of_speech_context_id() + 1> create_context_id_index() {
+    std::array<int8_t, max_part_of_speech_context_id() + 1> context_id_index{};
+    for (size_t i = 0; i < context_id_index.size(); i++) context_id_index[i] = -1;
+    for (size_t i = 0; i < part_of_speech_data.size(); i++) {
+        context_id_index[part_of_speech_data[i].context_id] = (int8_t)i;
+    }
+    return context_id_index;
+}
+
+static constexpr std::array<int8_t, max_part_of_speech_context_id() + 1> context_id_index = create_context_id_index();
+
+inline const PartOfSpeechDetail *search_part_of_speech(int context_id) {
+    if (context_id < 0 || (size_t)context_id >= context_id_index.size()) return nullptr;
+    int index = context_id_index[context_id];
+    return index < 0 ? nullptr : &part_of_speech_data[index];
+}
+
+inline const PartOfSpeechDetail *search_part_of_speech(const std::string &word_type) {
+    for (const PartOfSpeechDetail &detail : part_of_speech_data) {
+        if (word_type == detail.word_type) return &detail;
+    }
+    return nullptr;
+}
 
 #endif // PART_OF_SPEECH_DATA_H
@@ -0,0 +1,407 @@
+#include <cstring>
+
+#include "pcm_kernel.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define PCM_KERNEL_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(__aarch64__) || defined(_M_ARM64)
+#define PCM_KERNEL_NEON
+#include <arm_neon.h>
+#endif
+
+// GCCとClangではAVX2の関数だけを個別にコンパイルする。MSVCは指定なしで組み込み関数を使える
+#if defined(PCM_KERNEL_X86) && (defined(__GNUC__) || defined(__clang__))
+#define PCM_KERNEL_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define PCM_KERNEL_TARGET_AVX2
+#endif
+
+// 書き込む値はホストのバイト順になるが、対象とするx86とARMはどちらもリトルエンディアン
+static void convert_to_int16_scalar(const float *input, size_t size, float gain, int num_channels, int16_t *output) {
+    for (size_t i = 0; i < size; i++) {
+        float v = input[i] * gain;
+        // clip
+        v = 1.0f < v ? 1.0f : v;
+        v = -1.0f > v ? -1.0f : v;
+        int16_t data = (int16_t)(v * (float)0x7fff);
+        for (int j = 0; j < num_channels; j++) {
+            output[i * num_channels + j] = data;
+        }
+    }
+}
+
+// SIMD版の二乗和はレーンごとにfloatで足し、一定の長さごとにdoubleへ移して精度を保つ
+constexpr size_t SUM_OF_SQUARES_CHUNK = 4096;
+
+static double sum_of_squares_scalar(const float *input, size_t size) {
+    double sum = 0.0;
+    for (size_t i = 0; i < size; i++) {
+        sum += (double)input[i] * input[i];
+    }
+    return sum;
+}
+
+static float peak_scalar(const float *input, size_t size) {
+    float peak = 0.0f;
+    for (size_t i = 0; i < size; i++) {
+        float v = input[i] < 0.0f ? -input[i] : input[i];
+        peak = v > peak ? v : peak;
+    }
+    return peak;
+}
+
+static void scale_scalar(float *samples, size_t size, float gain) {
+    for (size_t i = 0; i < size; i++) {
+        samples[i] *= gain;
+    }
+}
+
+#ifdef PCM_KERNEL_X86
+static void convert_to_int16_sse2(const float *input, size_t size, float gain, int num_channels, int16_t *output) {
+    if (num_channels != 1 && num_channels != 2) {
+        convert_to_int16_scalar(input, size, gain, num_channels, output);
+        return;
+    }
+
+    const __m128 gain_v = _mm_set1_ps(gain);
+    const __m128 max_v = _mm_set1_ps(1.0f);
+    const __m128 min_v = _mm_set1_ps(-1.0f);
+    const __m128 scale_v = _mm_set1_ps((float)0x7fff);
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        __m128 a = _mm_mul_ps(_mm_loadu_ps(input + i), gain_v);
+        __m128 b = _mm_mul_ps(_mm_loadu_ps(input + i + 4), gain_v);
+        a = _mm_max_ps(_mm_min_ps(a, max_v), min_v);
+        b = _mm_max_ps(_mm_min_ps(b, max_v), min_v);
+        // スカラー版のキャストと同じく0方向に切り捨てる
+        __m128i packed = _mm_packs_epi32(
+            _mm_cvttps_epi32(_mm_mul_ps(a, scale_v)),
+            _mm_cvttps_epi32(_mm_mul_ps(b, scale_v))
+        );
+        if (num_channels == 1) {
+            _mm_storeu_si128((__m128i *)(output + i), packed);
+        } else {
+            _mm_storeu_si128((__m128i *)(output + i * 2), _mm_unpacklo_epi16(packed, packed));
+            _mm_storeu_si128((__m128i *)(output + i * 2 + 8), _mm_unpackhi_epi16(packed, packed));
+        }
+    }
+    convert_to_int16_scalar(input + i, size - i, gain, num_channels, output + i * num_channels);
+}
+
+PCM_KERNEL_TARGET_AVX2
+static void convert_to_int16_avx2(const float *input, size_t size, float gain, int num_channels, int16_t *output) {
+    if (num_channels != 1 && num_channels != 2) {
+        convert_to_int16_scalar(input, size, gain, num_channels, output);
+        return;
+    }
+
+    const __m256 gain_v = _mm256_set1_ps(gain);
+    const __m256 max_v = _mm256_set1_ps(1.0f);
+    const __m256 min_v = _mm256_set1_ps(-1.0f);
+    const __m256 scale_v = _mm256_set1_ps((float)0x7fff);
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        __m256 a = _mm256_mul_ps(_mm256_loadu_ps(input + i), gain_v);
+        __m256 b = _mm256_mul_ps(_mm256_loadu_ps(input + i + 8), gain_v);
+        a = _mm256_max_ps(_mm256_min_ps(a, max_v), min_v);
+        b = _mm256_max_ps(_mm256_min_ps(b, max_v), min_v);
+        // packsは128bitごとに詰めるので、並びを元の順番に戻す
+        __m256i packed = _mm256_permute4x64_epi64(
+            _mm256_packs_epi32(
+                _mm256_cvttps_epi32(_mm256_mul_ps(a, scale_v)),
+                _mm256_cvttps_epi32(_mm256_mul_ps(b, scale_v))
+            ),
+            0xd8
+        );
+        if (num_channels == 1) {
+            _mm256_storeu_si256((__m256i *)(output + i), packed);
+        } else {
+            __m256i low = _mm256_unpacklo_epi16(packed, packed);
+            __m256i high = _mm256_unpackhi_epi16(packed, packed);
+            _mm256_storeu_si256((__m256i *)(output + i * 2), _mm256_permute2x128_si256(low, high, 0x20));
+            _mm256_storeu_si256((__m256i *)(output + i * 2 + 16), _mm256_permute2x128_si256(low, high, 0x31));
+        }
+    }
+    convert_to_int16_scalar(input + i, size - i, gain, num_channels, output + i * num_channels);
+}
+
+static double sum_of_squares_sse2(const float *input, size_t size) {
+    double sum = 0.0;
+    size_t i = 0;
+    while (i + 4 <= size) {
+        size_t end = i + SUM_OF_SQUARES_CHUNK < size ? i + SUM_OF_SQUARES_CHUNK : size;
+        __m128 acc = _mm_setzero_ps();
+        for (; i + 4 <= end; i += 4) {
+            __m128 v = _mm_loadu_ps(input + i);
+            acc = _mm_add_ps(acc, _mm_mul_ps(v, v));
+        }
+        float lanes[4];
+        _mm_storeu_ps(lanes, acc);
+        sum += (double)lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    }
+    return sum + sum_of_squares_scalar(input + i, size - i);
+}
+
+static float peak_sse2(const float *input, size_t size) {
+    const __m128 abs_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+    __m128 peak_v = _mm_setzero_ps();
+    size_t i = 0;
+    for (; i + 4 <= size; i += 4) {
+        peak_v = _mm_max_ps(peak_v, _mm_and_ps(_mm_loadu_ps(input + i), abs_mask));
+    }
+    float lanes[4];
+    _mm_storeu_ps(lanes, peak_v);
+    float peak = peak_scalar(input + i, size - i);
+    for (float lane : lanes) peak = lane > peak ? lane : peak;
+    return peak;
+}
+
+static void scale_sse2(float *samples, size_t size, float gain) {
+    const __m128 gain_v = _mm_set1_ps(gain);
+    size_t i = 0;
+    for (; i + 4 <= size; i += 4) {
+        _mm_storeu_ps(samples + i, _mm_mul_ps(_mm_loadu_ps(samples + i), gain_v));
+    }
+    scale_scalar(samples + i, size - i, gain);
+}
+
+PCM_KERNEL_TARGET_AVX2
+static double sum_of_squares_avx2(const float *input, size_t size) {
+    double sum = 0.0;
+    size_t i = 0;
+    while (i + 8 <= size) {
+        size_t end = i + SUM_OF_SQUARES_CHUNK < size ? i + SUM_OF_SQUARES_CHUNK : size;
+        __m256 acc = _mm256_setzero_ps();
+        for (; i + 8 <= end; i += 8) {
+            __m256 v = _mm256_loadu_ps(input + i);
+            acc = _mm256_add_ps(acc, _mm256_mul_ps(v, v));
+        }
+        float lanes[8];
+        _mm256_storeu_ps(lanes, acc);
+        for (float lane : lanes) sum += lane;
+    }
+    return sum + sum_of_squares_scalar(input + i, size - i);
+}
+
+PCM_KERNEL_TARGET_AVX2
+static float peak_avx2(const float *input, size_t size) {
+    const __m256 abs_mask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+    __m256 peak_v = _mm256_setzero_ps();
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        peak_v = _mm256_max_ps(peak_v, _mm256_and_ps(_mm256_loadu_ps(input + i), abs_mask));
+    }
+    float lanes[8];
+    _mm256_storeu_ps(lanes, peak_v);
+    float peak = peak_scalar(input + i, size - i);
+    for (float lane : lanes) peak = lane > peak ? lane : peak;
+    return peak;
+}
+
+PCM_KERNEL_TARGET_AVX2
+static void scale_avx2(float *samples, size_t size, float gain) {
+    const __m256 gain_v = _mm256_set1_ps(gain);
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        _mm256_storeu_ps(samples + i, _mm256_mul_ps(_mm256_loadu_ps(samples + i), gain_v));
+    }
+    scale_scalar(samples + i, size - i, gain);
+}
+
+static bool cpu_supports_avx2() {
+#if defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) return false;
+    __cpuid(info, 1);
+    // OSがYMMレジスタを保存するか(OSXSAVEとXCR0)も確認する
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool avx = (info[2] & (1 << 28)) != 0;
+    if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6) return false;
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+#endif // PCM_KERNEL_X86
+
+#ifdef PCM_KERNEL_NEON
+static void convert_to_int16_neon(const float *input, size_t size, float gain, int num_channels, int16_t *output) {
+    if (num_channels != 1 && num_channels != 2) {
+        convert_to_int16_scalar(input, size, gain, num_channels, output);
+        return;
+    }
+
+    const float32x4_t max_v = vdupq_n_f32(1.0f);
+    const float32x4_t min_v = vdupq_n_f32(-1.0f);
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        float32x4_t a = vmulq_n_f32(vld1q_f32(input + i), gain);
+        float32x4_t b = vmulq_n_f32(vld1q_f32(input + i + 4), gain);
+        a = vmaxq_f32(vminq_f32(a, max_v), min_v);
+        b = vmaxq_f32(vminq_f32(b, max_v), min_v);
+        // vcvtqは0方向に切り捨てる
+        int16x8_t packed = vcombine_s16(
+            vqmovn_s32(vcvtq_s32_f32(vmulq_n_f32(a, (float)0x7fff))),
+            vqmovn_s32(vcvtq_s32_f32(vmulq_n_f32(b, (float)0x7fff)))
+        );
+        if (num_channels == 1) {
+            vst1q_s16(output + i, packed);
+        } else {
+            int16x8x2_t stereo = { { packed, packed } };
+            vst2q_s16(output + i * 2, stereo);
+        }
+    }
+    convert_to_int16_scalar(input + i, size - i, gain, num_channels, output + i * num_channels);
+}
+
+static double sum_of_squares_neon(const float *input, size_t size) {
+    double sum = 0.0;
+    size_t i = 0;
+    while (i + 4 <= size) {
+        size_t end = i + SUM_OF_SQUARES_CHUNK < size ? i + SUM_OF_SQUARES_CHUNK : size;
+        float32x4_t acc = vdupq_n_f32(0.0f);
+        for (; i + 4 <= end; i += 4) {
+            float32x4_t v = vld1q_f32(input + i);
+            acc = vmlaq_f32(acc, v, v);
+        }
+        sum += vaddvq_f32(acc);
+    }
+    return sum + sum_of_squares_scalar(input + i, size - i);
+}
+
+static float peak_neon(const float *input, size_t size) {
+    float32x4_t peak_v = vdupq_n_f32(0.0f);
+    size_t i = 0;
+    for (; i + 4 <= size; i += 4) {
+        peak_v = vmaxq_f32(peak_v, vabsq_f32(vld1q_f32(input + i)));
+    }
+    float peak = peak_scalar(input + i, size - i);
+    float lane = vmaxvq_f32(peak_v);
+    return lane > peak ? lane : peak;
+}
+
+static void scale_neon(float *samples, size_t size, float gain) {
+    size_t i = 0;
+    for (; i + 4 <= size; i += 4) {
+        vst1q_f32(samples + i, vmulq_n_f32(vld1q_f32(samples + i), gain));
+    }
+    scale_scalar(samples + i, size - i, gain);
+}
+#endif // PCM_KERNEL_NEON
+
+PcmInt16Converter get_pcm_int16_converter(PcmKernelType type) {
+    switch (type) {
+    case PCM_KERNEL_SCALAR:
+        return convert_to_int16_scalar;
+#ifdef PCM_KERNEL_X86
+    case PCM_KERNEL_SSE2:
+        return convert_to_int16_sse2;
+    case PCM_KERNEL_AVX2:
+        return cpu_supports_avx2() ? convert_to_int16_avx2 : nullptr;
+#endif
+#ifdef PCM_KERNEL_NEON
+    case PCM_KERNEL_NEON:
+        return convert_to_int16_neon;
+#endif
+    default:
+        return nullptr;
+    }
+}
+
+PcmAnalysisKernel get_pcm_analysis_kernel(PcmKernelType type) {
+    switch (type) {
+    case PCM_KERNEL_SCALAR:
+        return { sum_of_squares_scalar, peak_scalar, scale_scalar };
+#ifdef PCM_KERNEL_X86
+    case PCM_KERNEL_SSE2:
+        return { sum_of_squares_sse2, peak_sse2, scale_sse2 };
+    case PCM_KERNEL_AVX2:
+        if (cpu_supports_avx2()) return { sum_of_squares_avx2, peak_avx2, scale_avx2 };
+        return { nullptr, nullptr, nullptr };
+#endif
+#ifdef PCM_KERNEL_NEON
+    case PCM_KERNEL_NEON:
+        return { sum_of_squares_neon, peak_neon, scale_neon };
+#endif
+    default:
+        return { nullptr, nullptr, nullptr };
+    }
+}
+
+PcmKernelType best_pcm_kernel_type() {
+    static const PcmKernelType best = []() {
+        const PcmKernelType candidates[] = { PCM_KERNEL_AVX2, PCM_KERNEL_NEON, PCM_KERNEL_SSE2 };
+        for (PcmKernelType type : candidates) {
+            if (get_pcm_int16_converter(type) != nullptr) return type;
+        }
+        return PCM_KERNEL_SCALAR;
+    }();
+    return best;
+}
+
+const char *pcm_kernel_type_name(PcmKernelType type) {
+    switch (type) {
+    case PCM_KERNEL_SCALAR: return "scalar";
+    case PCM_KERNEL_SSE2: return "sse2";
+    case PCM_KERNEL_AVX2: return "avx2";
+    case PCM_KERNEL_NEON: return "neon";
+    }
+    return "unknown";
+}
+
+void convert_to_int16(const float *input, size_t size, float gain, int num_channels, int16_t *output) {
+    static const PcmInt16Converter converter = get_pcm_int16_converter(best_pcm_kernel_type());
+    converter(input, size, gain, num_channels, output);
+}
+
+void convert_to_int24(const float *input, size_t size, float gain, int num_channels, uint8_t *output) {
+    for (size_t i = 0; i < size; i++) {
+        float v = input[i] * gain;
+        // clip
+        v = 1.0f < v ? 1.0f : v;
+        v = -1.0f > v ? -1.0f : v;
+        int32_t data = (int32_t)(v * (float)0x7fffff);
+        for (int j = 0; j < num_channels; j++) {
+            uint8_t *dst = output + (i * num_channels + j) * 3;
+            dst[0] = (uint8_t)(data & 0xff);
+            dst[1] = (uint8_t)((data >> 8) & 0xff);
+            dst[2] = (uint8_t)((data >> 16) & 0xff);
+        }
+    }
+}
+
+void convert_to_float32(const float *input, size_t size, float gain, int num_channels, uint8_t *output) {
+    // WAVのヘッダの後ろは4byte境界に揃わないことがあるので、memcpyで書き込む
+    for (size_t i = 0; i < size; i++) {
+        float v = input[i] * gain;
+        for (int j = 0; j < num_channels; j++) {
+            std::memcpy(output + (i * num_channels + j) * sizeof(float), &v, sizeof(float));
+        }
+    }
+}
+
+static const PcmAnalysisKernel &best_pcm_analysis_kernel() {
+    static const PcmAnalysisKernel kernel = get_pcm_analysis_kernel(best_pcm_kernel_type());
+    return kernel;
+}
+
+double sum_of_squares(const float *input, size_t size) {
+    return best_pcm_analysis_kernel().sum_of_squares(input, size);
+}
+
+float peak_abs(const float *input, size_t size) {
+    return best_pcm_analysis_kernel().peak(input, size);
+}
+
+void scale_samples(float *samples, size_t size, float gain) {
+    best_pcm_analysis_kernel().scale(samples, size, gain);
+}
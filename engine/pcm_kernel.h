@@ -0,0 +1,48 @@
+#ifndef PCM_KERNEL_H
+#define PCM_KERNEL_H
+
+#include <cstddef>
+#include <cstdint>
+
+enum PcmKernelType {
+    PCM_KERNEL_SCALAR,
+    PCM_KERNEL_SSE2,
+    PCM_KERNEL_AVX2,
+    PCM_KERNEL_NEON,
+};
+
+// 利得をかけて[-1, 1]に収め、16bit整数に変換してチャンネル数分複製しながら書き込む
+// outputにはsize * num_channels個分の領域が必要
+typedef void (*PcmInt16Converter)(const float *input, size_t size, float gain, int num_channels, int16_t *output);
+
+// 実行中のCPUで使えない場合はnullptrを返す
+PcmInt16Converter get_pcm_int16_converter(PcmKernelType type);
+PcmKernelType best_pcm_kernel_type();
+const char *pcm_kernel_type_name(PcmKernelType type);
+
+// 音量の測定と調整に使うカーネル
+struct PcmAnalysisKernel {
+    // 二乗和
+    double (*sum_of_squares)(const float *input, size_t size);
+    // 絶対値の最大値
+    float (*peak)(const float *input, size_t size);
+    // samplesにgainをかける
+    void (*scale)(float *samples, size_t size, float gain);
+};
+
+// 実行中のCPUで使えない場合は全てnullptrになる
+PcmAnalysisKernel get_pcm_analysis_kernel(PcmKernelType type);
+
+// 実行中のCPUで最も速い実装を使って変換する
+void convert_to_int16(const float *input, size_t size, float gain, int num_channels, int16_t *output);
+// 24bitのリトルエンディアン(1サンプル3byte)で書き込む
+void convert_to_int24(const float *input, size_t size, float gain, int num_channels, uint8_t *output);
+// 浮動小数点のまま出力するため、クリップはしない。outputの位置揃えは不要
+void convert_to_float32(const float *input, size_t size, float gain, int num_channels, uint8_t *output);
+
+// 実行中のCPUで最も速い実装を使って測定、調整する
+double sum_of_squares(const float *input, size_t size);
+float peak_abs(const float *input, size_t size);
+void scale_samples(float *samples, size_t size, float gain);
+
+#endif // PCM_KERNEL_H
@@ -0,0 +1,158 @@
+#include <algorithm>
+#include <cmath>
+
+#include "pcm_kernel.h"
+#include "post_process.h"
+
+constexpr double PI = 3.14159265358979323846;
+// BS.1770のブロックは400msで、75%ずつ重ねる
+constexpr double LOUDNESS_BLOCK_LENGTH = 0.4;
+constexpr int LOUDNESS_BLOCK_STEPS = 4;
+constexpr double ABSOLUTE_GATE = -70.0;
+constexpr double RELATIVE_GATE = -10.0;
+constexpr double TRIM_WINDOW_LENGTH = 0.01;
+
+struct Biquad {
+    double b0, b1, b2, a1, a2;
+};
+
+// K特性の高域シェルフと高域通過を、sampling_rateに合わせて設計する
+static void k_weighting_filters(int sampling_rate, Biquad &shelf, Biquad &high_pass) {
+    {
+        double gain = std::pow(10.0, 4.0 / 40.0);
+        double w0 = 2.0 * PI * 1500.0 / sampling_rate;
+        double alpha = std::sin(w0) / (2.0 * (1.0 / std::sqrt(2.0)));
+        double cos_w0 = std::cos(w0);
+        double sqrt_alpha = 2.0 * std::sqrt(gain) * alpha;
+        double a0 = (gain + 1.0) - (gain - 1.0) * cos_w0 + sqrt_alpha;
+        shelf.b0 = gain * ((gain + 1.0) + (gain - 1.0) * cos_w0 + sqrt_alpha) / a0;
+        shelf.b1 = -2.0 * gain * ((gain - 1.0) + (gain + 1.0) * cos_w0) / a0;
+        shelf.b2 = gain * ((gain + 1.0) + (gain - 1.0) * cos_w0 - sqrt_alpha) / a0;
+        shelf.a1 = 2.0 * ((gain - 1.0) - (gain + 1.0) * cos_w0) / a0;
+        shelf.a2 = ((gain + 1.0) - (gain - 1.0) * cos_w0 - sqrt_alpha) / a0;
+    }
+    {
+        double w0 = 2.0 * PI * 38.0 / sampling_rate;
+        double alpha = std::sin(w0) / (2.0 * 0.5);
+        double cos_w0 = std::cos(w0);
+        double a0 = 1.0 + alpha;
+        high_pass.b0 = (1.0 + cos_w0) / 2.0 / a0;
+        high_pass.b1 = -(1.0 + cos_w0) / a0;
+        high_pass.b2 = (1.0 + cos_w0) / 2.0 / a0;
+        high_pass.a1 = -2.0 * cos_w0 / a0;
+        high_pass.a2 = (1.0 - alpha) / a0;
+    }
+}
+
+// 再帰フィルタは時間方向に依存するので、ここだけはスカラーで処理する
+static void apply_biquad(const Biquad &filter, std::vector<float> &samples) {
+    double x1 = 0.0, x2 = 0.0, y1 = 0.0, y2 = 0.0;
+    for (float &sample : samples) {
+        double x0 = sample;
+        double y0 = filter.b0 * x0 + filter.b1 * x1 + filter.b2 * x2 - filter.a1 * y1 - filter.a2 * y2;
+        x2 = x1;
+        x1 = x0;
+        y2 = y1;
+        y1 = y0;
+        sample = (float)y0;
+    }
+}
+
+static double to_loudness(double mean_square) {
+    return -0.691 + 10.0 * std::log10(mean_square);
+}
+
+double measure_loudness(const float *wave, size_t size, int sampling_rate) {
+    if (size == 0) return -INFINITY;
+
+    Biquad shelf, high_pass;
+    k_weighting_filters(sampling_rate, shelf, high_pass);
+    std::vector<float> weighted(wave, wave + size);
+    apply_biquad(shelf, weighted);
+    apply_biquad(high_pass, weighted);
+
+    // 1ブロックに満たない短い音声は、全体を1つのブロックとみなして相対ゲートをかけずに測る
+    size_t step = (size_t)(LOUDNESS_BLOCK_LENGTH * sampling_rate / LOUDNESS_BLOCK_STEPS);
+    if (step == 0 || size < step * LOUDNESS_BLOCK_STEPS) {
+        double loudness = to_loudness(sum_of_squares(weighted.data(), size) / (double)size);
+        return loudness > ABSOLUTE_GATE ? loudness : -INFINITY;
+    }
+
+    // 100msごとの二乗和から、重なり合う400msのブロックの平均を作る
+    size_t num_steps = size / step;
+    std::vector<double> step_sums(num_steps);
+    for (size_t i = 0; i < num_steps; i++) {
+        step_sums[i] = sum_of_squares(weighted.data() + i * step, step);
+    }
+    std::vector<double> blocks;
+    for (size_t i = 0; i + LOUDNESS_BLOCK_STEPS <= num_steps; i++) {
+        double sum = 0.0;
+        for (int j = 0; j < LOUDNESS_BLOCK_STEPS; j++) sum += step_sums[i + j];
+        blocks.push_back(sum / (double)(step * LOUDNESS_BLOCK_STEPS));
+    }
+
+    double absolute_sum = 0.0;
+    size_t absolute_count = 0;
+    for (double block : blocks) {
+        if (to_loudness(block) > ABSOLUTE_GATE) {
+            absolute_sum += block;
+            absolute_count++;
+        }
+    }
+    if (absolute_count == 0) return -INFINITY;
+
+    double relative_gate = to_loudness(absolute_sum / absolute_count) + RELATIVE_GATE;
+    double relative_sum = 0.0;
+    size_t relative_count = 0;
+    for (double block : blocks) {
+        double loudness = to_loudness(block);
+        if (loudness > ABSOLUTE_GATE && loudness > relative_gate) {
+            relative_sum += block;
+            relative_count++;
+        }
+    }
+    return to_loudness(relative_sum / relative_count);
+}
+
+float loudness_gain(const float *wave, size_t size, int sampling_rate, float target_loudness) {
+    double loudness = measure_loudness(wave, size, sampling_rate);
+    if (!std::isfinite(loudness)) return 1.0f;
+
+    float gain = (float)std::pow(10.0, (target_loudness - loudness) / 20.0);
+    float peak = peak_abs(wave, size);
+    if (peak * gain > 1.0f) gain = 1.0f / peak;
+    return gain;
+}
+
+bool find_sound_range(
+    const float *wave,
+    size_t size,
+    int sampling_rate,
+    float threshold,
+    float margin,
+    size_t &start,
+    size_t &end
+) {
+    size_t window = std::max((size_t)(TRIM_WINDOW_LENGTH * sampling_rate), (size_t)1);
+    // RMSの比較を二乗和の比較に置き換える
+    double threshold_square = std::pow(10.0, threshold / 10.0) * window;
+
+    size_t num_windows = (size + window - 1) / window;
+    size_t first = num_windows;
+    size_t last = 0;
+    for (size_t i = 0; i < num_windows; i++) {
+        size_t length = std::min(window, size - i * window);
+        if (sum_of_squares(wave + i * window, length) > threshold_square) {
+            first = std::min(first, i);
+            last = i;
+        }
+    }
+    if (first == num_windows) return false;
+
+    size_t margin_samples = (size_t)(margin * sampling_rate);
+    size_t sound_start = first * window;
+    size_t sound_end = std::min((last + 1) * window, size);
+    start = sound_start > margin_samples ? sound_start - margin_samples : 0;
+    end = std::min(sound_end + margin_samples, size);
+    return true;
+}
@@ -0,0 +1,37 @@
+#ifndef POST_PROCESS_H
+#define POST_PROCESS_H
+
+#include <cstddef>
+#include <vector>
+
+// PCMに変換する前の波形にかける後処理
+struct PostProcessOptions {
+    // 前後の無音を切り詰める
+    bool trim = false;
+    // 10msごとのRMSがこれ(dBFS)を超える範囲を音声とみなす
+    float trim_threshold = -50.0f;
+    // 音声の範囲の前後に残す長さ(秒)
+    float trim_margin = 0.02f;
+    // ラウドネスをtarget_loudness(LUFS)に揃える
+    bool normalize = false;
+    float target_loudness = -23.0f;
+};
+
+// ITU-R BS.1770のK特性とゲートを使ったラウドネス(LUFS)
+// 400msより短い場合は、全体の平均を絶対ゲートのみで測る
+// ゲートを通るブロックがない(ほぼ無音の)場合は-INFINITYを返す
+double measure_loudness(const float *wave, size_t size, int sampling_rate);
+// ラウドネスがtarget_loudnessになる利得。ピークが1を超えないように抑える
+float loudness_gain(const float *wave, size_t size, int sampling_rate, float target_loudness);
+// 閾値を超える範囲にmarginを足した[start, end)を求める。全て閾値以下の場合はfalseを返す
+bool find_sound_range(
+    const float *wave,
+    size_t size,
+    int sampling_rate,
+    float threshold,
+    float margin,
+    size_t &start,
+    size_t &end
+);
+
+#endif // POST_PROCESS_H
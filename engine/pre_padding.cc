@@ -0,0 +1,79 @@
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+#include "acoustic_feature_extractor.h"
+#include "pre_padding.h"
+
+// decode_forwardは1フレームあたり256サンプル、24kHzの波形を出力する
+constexpr int DECODER_SAMPLING_RATE = 24000;
+constexpr int DECODER_FRAME_SIZE = 256;
+// 無音の後に続ける母音の長さと音高(対数)
+constexpr int PROBE_VOICED_FRAMES = 30;
+constexpr float PROBE_F0 = 5.5f;
+// 母音の部分の差の二乗平均平方根が、既定の余白で復号したものの1%(-40dB)以下なら一致とみなす
+constexpr double VOICED_MATCH_TOLERANCE = 0.01;
+// synthesisの音素長の単位(1/200秒)に揃える
+constexpr float PRE_PADDING_STEP = 0.005f;
+
+// silence_framesのpauの後にPROBE_VOICED_FRAMESの母音を続けて復号し、母音の部分の波形を返す
+static std::vector<float> decode_probe(Core *core, int64_t speaker_id, int silence_frames) {
+    const int num_phoneme = OjtPhoneme::num_phoneme();
+    const std::map<std::string, int> phoneme_map = OjtPhoneme::phoneme_map();
+    const int length = silence_frames + PROBE_VOICED_FRAMES;
+
+    std::vector<float> f0(length, 0.0f);
+    std::vector<float> phoneme(length * num_phoneme, 0.0f);
+    for (int i = 0; i < length; i++) {
+        bool voiced = i >= silence_frames;
+        if (voiced) f0[i] = PROBE_F0;
+        int phoneme_id = phoneme_map.at(voiced ? "a" : OjtPhoneme::space_phoneme());
+        phoneme[i * num_phoneme + phoneme_id] = 1.0f;
+    }
+
+    std::vector<float> wave(length * DECODER_FRAME_SIZE, 0.0f);
+    long speaker = (long)speaker_id;
+    if (!core->decode_forward(length, num_phoneme, f0.data(), phoneme.data(), &speaker, wave.data())) {
+        throw std::runtime_error(core->last_error_message());
+    }
+    return std::vector<float>(wave.begin() + (size_t)silence_frames * DECODER_FRAME_SIZE, wave.end());
+}
+
+float calibrate_pre_padding(Core *core, int64_t speaker_id) {
+    const float frame_rate = (float)DECODER_SAMPLING_RATE / DECODER_FRAME_SIZE;
+    const int default_frames = (int)std::ceil(DEFAULT_PRE_PADDING_LENGTH * frame_rate);
+    const int min_frames = (int)std::ceil(MIN_PRE_PADDING_LENGTH * frame_rate);
+
+    std::vector<float> reference = decode_probe(core, speaker_id, default_frames);
+    double reference_energy = 0.0;
+    for (float value : reference) reference_energy += (double)value * value;
+    // 母音が無音として復号される話者では比べようがないので、既定値のままにする
+    if (reference_energy == 0.0) return DEFAULT_PRE_PADDING_LENGTH;
+
+    // 短い順に試し、最初に既定の余白と同じ母音が得られた長さを使う
+    for (int frames = min_frames; frames < default_frames; frames++) {
+        std::vector<float> voiced = decode_probe(core, speaker_id, frames);
+        double error_energy = 0.0;
+        for (size_t i = 0; i < reference.size(); i++) {
+            double error = (double)voiced[i] - reference[i];
+            error_energy += error * error;
+        }
+        if (std::sqrt(error_energy / reference_energy) > VOICED_MATCH_TOLERANCE) continue;
+
+        float length_sec = std::ceil((float)frames / frame_rate / PRE_PADDING_STEP) * PRE_PADDING_STEP;
+        return std::min(std::max(length_sec, MIN_PRE_PADDING_LENGTH), DEFAULT_PRE_PADDING_LENGTH);
+    }
+    return DEFAULT_PRE_PADDING_LENGTH;
+}
+
+float PrePaddingTable::get(int64_t speaker_id) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_lengths.find(speaker_id);
+    return it == m_lengths.end() ? DEFAULT_PRE_PADDING_LENGTH : it->second;
+}
+
+void PrePaddingTable::set(int64_t speaker_id, float length) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_lengths[speaker_id] = length;
+}
@@ -0,0 +1,32 @@
+#ifndef PRE_PADDING_H
+#define PRE_PADDING_H
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+
+#include "../core/core.h"
+
+// workaround of Hiroshiba/voicevox_engine#128
+// 先頭にpauを足して復号し、立ち上がりの雑音を含む部分を捨てる。捨てる長さの既定値
+constexpr float DEFAULT_PRE_PADDING_LENGTH = 0.4f;
+// 校正しても、これより短くはしない
+constexpr float MIN_PRE_PADDING_LENGTH = 0.05f;
+
+// 無音から話し始める入力を、pauの長さを変えながら復号する
+// 母音の部分がDEFAULT_PRE_PADDING_LENGTHで復号したものと許容誤差の範囲で一致する、最も短い長さを返す
+// どの長さでも一致しない場合はDEFAULT_PRE_PADDING_LENGTHを返す
+float calibrate_pre_padding(Core *core, int64_t speaker_id);
+
+// 話者ごとの余白の長さ。校正していない話者にはDEFAULT_PRE_PADDING_LENGTHを返す
+class PrePaddingTable {
+public:
+    float get(int64_t speaker_id) const;
+    void set(int64_t speaker_id, float length);
+
+private:
+    mutable std::mutex m_mutex;
+    std::map<int64_t, float> m_lengths;
+};
+
+#endif // PRE_PADDING_H
@@ -0,0 +1,30 @@
+#ifndef PROBES_H
+#define PROBES_H
+
+// bpftraceやperfから使える静的トレースポイント(USDT)
+// Linuxでsys/sdt.h(systemtap-sdt-dev)がある場合のみ埋め込み、それ以外やENGINE_DISABLE_USDTの定義時は何もしない
+// 埋め込んだ箇所はnop命令1つになり、アタッチしていない間はほとんど負荷がかからない
+// プロバイダ名はvoicevox_engineで、bpftraceでは usdt:path/to/engine.node:voicevox_engine:<名前> で指定する
+
+#if defined(__linux__) && !defined(ENGINE_DISABLE_USDT) && defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define ENGINE_USDT_ENABLED 1
+#endif
+#endif
+
+#ifdef ENGINE_USDT_ENABLED
+#define ENGINE_PROBE0(name) DTRACE_PROBE(voicevox_engine, name)
+#define ENGINE_PROBE1(name, a1) DTRACE_PROBE1(voicevox_engine, name, a1)
+#define ENGINE_PROBE2(name, a1, a2) DTRACE_PROBE2(voicevox_engine, name, a1, a2)
+#define ENGINE_PROBE3(name, a1, a2, a3) DTRACE_PROBE3(voicevox_engine, name, a1, a2, a3)
+#define ENGINE_PROBE4(name, a1, a2, a3, a4) DTRACE_PROBE4(voicevox_engine, name, a1, a2, a3, a4)
+#else
+#define ENGINE_PROBE0(name) do {} while (0)
+#define ENGINE_PROBE1(name, a1) do {} while (0)
+#define ENGINE_PROBE2(name, a1, a2) do {} while (0)
+#define ENGINE_PROBE3(name, a1, a2, a3) do {} while (0)
+#define ENGINE_PROBE4(name, a1, a2, a3, a4) do {} while (0)
+#endif
+
+#endif // PROBES_H
@@ -0,0 +1,60 @@
+#ifndef STAGE_TIMER_H
+#define STAGE_TIMER_H
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "engine_metrics.h"
+#include "latency_stats.h"
+#include "memory_stats.h"
+#include "tracer.h"
+
+// 処理の段階ごとにかかった時間(ミリ秒)を記録し、latency_stats()とengine_metrics()のヒストグラムにも加える
+// トレースが有効な場合は段階ごとの区間を、メモリの集計が有効な場合は段階ごとに確保したbyte数も記録する
+class StageTimer {
+public:
+    StageTimer() {
+        m_start = std::chrono::steady_clock::now();
+        m_last = m_start;
+    }
+
+    // 前回の記録(初回は作成時かrestart())からの経過時間を、stageの段階として記録する
+    void record(LatencyStage stage) {
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        std::chrono::nanoseconds elapsed = now - m_last;
+        latency_stats().add(stage, (uint64_t)elapsed.count());
+        engine_metrics().stage_recorded(stage, (uint64_t)elapsed.count());
+        if (tracing_enabled()) trace_complete(latency_stage_name(stage), m_last, now);
+        if (memory_accounting_enabled) {
+            MemoryUsage usage = m_memory.restart();
+            memory_stats().add(stage, usage);
+            engine_metrics().add_memory(stage, usage);
+        }
+        m_stages.push_back(std::make_pair(std::string(latency_stage_name(stage)), elapsed.count() / 1e6));
+        m_last = now;
+    }
+
+    // 計測しない処理を挟んだ後、次の段階の開始時刻を今にする
+    void restart() {
+        m_last = std::chrono::steady_clock::now();
+        m_memory.restart();
+    }
+
+    const std::vector<std::pair<std::string, double>> &stages() const { return m_stages; }
+
+    // 作成してからの経過時間(ナノ秒)。restart()の影響を受けない
+    uint64_t elapsed_ns() const {
+        return (uint64_t)std::chrono::nanoseconds(std::chrono::steady_clock::now() - m_start).count();
+    }
+
+private:
+    std::chrono::steady_clock::time_point m_start;
+    std::chrono::steady_clock::time_point m_last;
+    std::vector<std::pair<std::string, double>> m_stages;
+    MemoryScope m_memory;
+};
+
+#endif // STAGE_TIMER_H
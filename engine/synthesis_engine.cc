@@ -1,9 +1,17 @@
+#include <algorithm>
+#include <exception>
+#include <functional>
 #include <iterator>
-#include <sstream>
+#include <mutex>
+#include <thread>
 
+#include "engine_metrics.h"
 #include "full_context_label.h"
 #include "mora_list.h"
+#include "pcm_kernel.h"
+#include "probes.h"
 #include "synthesis_engine.h"
+#include "tracer.h"
 
 std::vector<Napi::Object> to_flatten_moras(Napi::Array accent_phrases) {
     std::vector<Napi::Object> flatten_moras;
@@ -26,46 +34,6 @@ std::vector<Napi::Object> to_flatten_moras(Napi::Array accent_phrases) {
 }
 
 
-std::vector<OjtPhoneme> to_phoneme_data_list(std::vector<std::string> phoneme_str_list) {
-    std::vector<OjtPhoneme> phoneme_data_list;
-    for (size_t i = 0; i < phoneme_str_list.size(); i++) {
-        phoneme_data_list.push_back(OjtPhoneme(phoneme_str_list[i], (float)i, (float)i + 1.0));
-    }
-    return OjtPhoneme::convert(phoneme_data_list);
-}
-
-void split_mora(
-    std::vector<OjtPhoneme> phoneme_list,
-    std::vector<OjtPhoneme> &consonant_phoneme_list,
-    std::vector<OjtPhoneme> &vowel_phoneme_list,
-    std::vector<long> &vowel_indexes
-) {
-    for (size_t i = 0; i < phoneme_list.size(); i++) {
-        std::vector<std::string>::iterator result = std::find(
-            mora_phoneme_list.begin(),
-            mora_phoneme_list.end(),
-            phoneme_list[i].phoneme
-        );
-        if (result != mora_phoneme_list.end()) {
-            vowel_indexes.push_back((long)i);
-        }
-    }
-    for (int index : vowel_indexes) {
-        vowel_phoneme_list.push_back(phoneme_list[index]);
-    }
-    consonant_phoneme_list.push_back(OjtPhoneme());
-    for (size_t i = 0; i < vowel_indexes.size() - 1; i++) {
-        int prev = vowel_indexes[i];
-        int next = vowel_indexes[1 + i];
-        if (next - prev == 1) {
-            consonant_phoneme_list.push_back(OjtPhoneme());
-        } else {
-            consonant_phoneme_list.push_back(phoneme_list[next - 1]);
-        }
-    }
-    return;
-}
-
 Napi::Array adjust_interrogative_accent_phrases(Napi::Env env, Napi::Array accent_phrases) {
     Napi::Array new_accent_phrases = Napi::Array::New(env, accent_phrases.Length());
     for (size_t i = 0; i < accent_phrases.Length(); i++) {
@@ -120,13 +88,13 @@ Napi::Object make_interrogative_mora(Napi::Env env, Napi::Object last_mora) {
     return interrogative_mora;
 }
 
-Napi::Array SynthesisEngine::create_accent_phrases(Napi::Env env, Napi::String text, Napi::Number speaker_id) {
+Napi::Array SynthesisEngine::create_accent_phrases(Napi::Env env, Napi::String text, Napi::Number speaker_id, OpenJTalk *openjtalk) {
     std::string str_text = text.Utf8Value();
     if (str_text.size() == 0) {
         return Napi::Array::New(env);
     }
 
-    Utterance utterance = extract_full_context_label(m_openjtalk, str_text);
+    Utterance utterance = extract_full_context_label(openjtalk != nullptr ? openjtalk : m_openjtalk, str_text);
     if (utterance.breath_groups.size() == 0) {
         return Napi::Array::New(env);
     }
@@ -211,7 +179,9 @@ Napi::Array SynthesisEngine::replace_phoneme_length(Napi::Array accent_phrases,
     std::vector<int64_t> phoneme_list_s;
     for (OjtPhoneme phoneme_data : phoneme_data_list) phoneme_list_s.push_back(phoneme_data.phoneme_id());
     std::vector<float> phoneme_length(phoneme_list_s.size(), 0.0);
+    StageTimer timer;
     bool success = m_core->yukarin_s_forward(phoneme_list_s.size(), (long *)phoneme_list_s.data(), (long *)&speaker_id, phoneme_length.data());
+    timer.record(LATENCY_YUKARIN_S);
 
     if (!success) {
         throw std::runtime_error(m_core->last_error_message());
@@ -305,6 +275,7 @@ Napi::Array SynthesisEngine::replace_mora_pitch(Napi::Array accent_phrases, int6
 
     int length = vowel_phoneme_list.size();
     std::vector<float> f0_list(length, 0);
+    StageTimer timer;
     bool success = m_core->yukarin_sa_forward(
         length,
         (long *)vowel_phoneme_list.data(),
@@ -316,6 +287,7 @@ Napi::Array SynthesisEngine::replace_mora_pitch(Napi::Array accent_phrases, int6
         (long *)&speaker_id,
         f0_list.data()
     );
+    timer.record(LATENCY_YUKARIN_SA);
 
     if (!success) {
         throw std::runtime_error(m_core->last_error_message());
@@ -355,121 +327,399 @@ Napi::Array SynthesisEngine::replace_mora_pitch(Napi::Array accent_phrases, int6
     return accent_phrases;
 }
 
-Napi::Array SynthesisEngine::synthesis_array(Napi::Env env, Napi::Object query, long speaker_id, bool enable_interrogative_upspeak) {
-    std::vector<float> wave = synthesis(env, query, speaker_id, enable_interrogative_upspeak);
+std::vector<float> SynthesisEngine::output_wave(
+    const DecodeRequest &request,
+    bool resample,
+    SilenceLength &silence,
+    StageTimer &timer
+) {
+    std::vector<float> wave = decode(request);
+    timer.record(LATENCY_DECODE);
+
+    float speed_scale = request.speed_scale;
+    float sampling_rate = (float)(resample ? request.output_sampling_rate : default_sampling_rate);
+    if (request.direct_silence) {
+        silence.leading = (size_t)std::round(
+            std::max(request.pre_phoneme_length - DIRECT_SILENCE_MARGIN, 0.0f) / speed_scale * sampling_rate
+        );
+        silence.trailing = (size_t)std::round(
+            std::max(request.post_phoneme_length - DIRECT_SILENCE_MARGIN, 0.0f) / speed_scale * sampling_rate
+        );
+    }
 
-    float volume_scale = query.Get("volumeScale").As<Napi::Number>().FloatValue();
-    float speed_scale = query.Get("speedScale").As<Napi::Number>().FloatValue();
-    bool output_stereo = query.Get("outputStereo").As<Napi::Boolean>().Value();
-    // TODO: 44.1kHzなどの対応
-    int output_sampling_rate = query.Get("outputSamplingRate").As<Napi::Number>().Int32Value();
+    // workaround of Hiroshiba/voicevox_engine#128
+    // 余白はspeed_scaleで縮めずに足しているので、そのままの長さを取り除く
+    size_t offset = (size_t)((float)default_sampling_rate * request.pre_padding_length);
+    offset = std::min(offset, wave.size());
+    std::vector<float> trimmed_wave(wave.begin() + offset, wave.end());
+
+    if (!resample) return trimmed_wave;
+    std::vector<float> resampled = WaveResampler::resample(trimmed_wave, default_sampling_rate, request.output_sampling_rate);
+    timer.record(LATENCY_RESAMPLE);
+    return resampled;
+}
 
-    int num_channels = output_stereo ? 2 : 1;
-    int repeat_count = (output_sampling_rate / default_sampling_rate) * num_channels;
+void SynthesisEngine::post_process(
+    const PostProcessOptions &options,
+    int sampling_rate,
+    std::vector<float> &wave,
+    SilenceLength &silence,
+    size_t &trim_start,
+    size_t &trim_end,
+    StageTimer &timer
+) {
+    trim_start = 0;
+    trim_end = silence.leading + wave.size() + silence.trailing;
+
+    if (options.trim) {
+        size_t start, end;
+        if (find_sound_range(
+            wave.data(), wave.size(), sampling_rate, options.trim_threshold, options.trim_margin, start, end
+        )) {
+            trim_start = silence.leading + start;
+            trim_end = silence.leading + end;
+            wave = std::vector<float>(wave.begin() + start, wave.begin() + end);
+            silence = SilenceLength();
+        }
+        timer.record(LATENCY_TRIM);
+    }
 
-    Napi::Array converted_wave = Napi::Array::New(env, wave.size() * repeat_count);
-    // workaround of Hiroshiba/voicevox_engine#128
-    size_t offset = (size_t)((float)default_sampling_rate * (pre_padding_length / speed_scale));
-    for (size_t i = offset; i < wave.size(); i++) {
-        size_t index = i - offset;
-        for (int j = 0; j < repeat_count; j++) {
-            converted_wave[index*repeat_count+j] = wave[i] * volume_scale;
+    if (options.normalize) {
+        float gain = loudness_gain(wave.data(), wave.size(), sampling_rate, options.target_loudness);
+        scale_samples(wave.data(), wave.size(), gain);
+        timer.record(LATENCY_NORMALIZE);
+    }
+}
+
+// 前後の無音を含めた出力の長さと、合成全体にかかった時間をengine_metrics()に加える
+static void add_synthesis_metrics(const std::vector<float> &wave, const SilenceLength &silence, int sampling_rate, const StageTimer &timer) {
+    size_t length = silence.leading + wave.size() + silence.trailing;
+    engine_metrics().add_synthesis((double)length / sampling_rate, timer.elapsed_ns());
+}
+
+Napi::Array SynthesisEngine::synthesis_array(Napi::Env env, Napi::Object query, long speaker_id, bool enable_interrogative_upspeak) {
+    StageTimer timer;
+    DecodeRequest request = create_decode_request(env, query, speaker_id, enable_interrogative_upspeak);
+    timer.record(LATENCY_FRAMES);
+    SilenceLength silence;
+    std::vector<float> wave = output_wave(request, true, silence, timer);
+
+    float volume_scale = request.volume_scale;
+    int num_channels = request.output_stereo ? 2 : 1;
+
+    Napi::Array converted_wave = Napi::Array::New(env, wave.size() * num_channels);
+    for (size_t i = 0; i < wave.size(); i++) {
+        for (int j = 0; j < num_channels; j++) {
+            converted_wave[i * num_channels + j] = wave[i] * volume_scale;
         }
     }
     return converted_wave;
 }
 
-Napi::Buffer<char> SynthesisEngine::synthesis_wave_format(Napi::Env env, Napi::Object query, long speaker_id, bool enable_interrogative_upspeak) {
-    std::vector<float> wave = synthesis(env, query, speaker_id, enable_interrogative_upspeak);
+float SynthesisEngine::calibrate_pre_padding(int64_t speaker_id) {
+    TraceScope trace("calibrate_pre_padding");
+    float length = ::calibrate_pre_padding(m_core, speaker_id);
+    m_pre_padding.set(speaker_id, length);
+    return length;
+}
 
-    float volume_scale = query.Get("volumeScale").As<Napi::Number>().FloatValue();
-    float speed_scale = query.Get("speedScale").As<Napi::Number>().FloatValue();
-    bool output_stereo = query.Get("outputStereo").As<Napi::Boolean>().Value();
-    // TODO: 44.1kHzなどの対応
-    int output_sampling_rate = query.Get("outputSamplingRate").As<Napi::Number>().Int32Value();
-
-    char num_channels = output_stereo ? 2 : 1;
-    char bit_depth = 16;
-    int repeat_count = (output_sampling_rate / default_sampling_rate) * num_channels;
-    int block_size = bit_depth * num_channels / 8;
-
-    std::stringstream ss;
-    ss.write("RIFF", 4);
-    int bytes_size = wave.size() * repeat_count * 8;
-    int wave_size = bytes_size + 44 - 8;
-    for (int i = 0; i < 4; i++) {
-        ss.put((uint8_t)(wave_size & 0xff)); // chunk size
-        wave_size >>= 8;
-    }
-    ss.write("WAVEfmt ", 8);
-
-    ss.put((char)16); // fmt header length
-    for (int i = 0; i < 3; i++) ss.put((uint8_t)0); // fmt header length
-    ss.put(1); // linear PCM
-    ss.put(0); // linear PCM
-    ss.put(num_channels); // channnel
-    ss.put(0); // channnel
-
-    int sampling_rate = output_sampling_rate;
-    for (int i = 0; i < 4; i++) {
-        ss.put((char)(sampling_rate & 0xff));
-        sampling_rate >>= 8;
-    }
-    int block_rate = output_sampling_rate * block_size;
-    for (int i = 0; i < 4; i++) {
-        ss.put((char)(block_rate & 0xff));
-        block_rate >>= 8;
-    }
-
-    ss.put(block_size);
-    ss.put(0);
-    ss.put(bit_depth);
-    ss.put(0);
-
-    ss.write("data", 4);
-    size_t data_p = ss.tellp();
-    for (int i = 0; i < 4; i++) {
-        ss.put((char)(bytes_size & 0xff));
-        block_rate >>= 8;
+Napi::Buffer<char> SynthesisEngine::synthesis_wave_format(
+    Napi::Env env,
+    Napi::Object query,
+    long speaker_id,
+    bool enable_interrogative_upspeak,
+    const SynthesisOptions &options
+) {
+    ENGINE_PROBE1(synthesis_wave_format_entry, speaker_id);
+    // 例外で抜けた場合も、successをfalseにしてsynthesis_wave_format_returnを発火させる
+    struct ReturnProbe {
+        long speaker_id;
+        size_t frames = 0;
+        size_t bytes = 0;
+        bool success = false;
+        ~ReturnProbe() { ENGINE_PROBE4(synthesis_wave_format_return, speaker_id, frames, bytes, success); }
+    } return_probe;
+    return_probe.speaker_id = speaker_id;
+    StageTimer timer;
+    DecodeRequest request = create_decode_request(
+        env, query, speaker_id, enable_interrogative_upspeak, options.direct_silence
+    );
+    timer.record(LATENCY_FRAMES);
+    // G.711は8kHzへの間引きを圧伸と一緒に行うので、合成したままの波形を渡す
+    bool g711 = is_g711_format(options.format);
+    SilenceLength silence;
+    std::vector<float> wave = output_wave(request, !g711, silence, timer);
+
+    size_t trim_start, trim_end;
+    int wave_sampling_rate = g711 ? default_sampling_rate : request.output_sampling_rate;
+    post_process(options.post_process, wave_sampling_rate, wave, silence, trim_start, trim_end, timer);
+
+    Napi::Buffer<char> buffer = write_wave(
+        env,
+        wave,
+        silence,
+        options.format,
+        request.output_stereo,
+        request.output_sampling_rate,
+        request.volume_scale
+    );
+    timer.record(LATENCY_ENCODE);
+    add_synthesis_metrics(wave, silence, wave_sampling_rate, timer);
+    return_probe.frames = request.f0.size();
+    return_probe.bytes = buffer.Length();
+    return_probe.success = true;
+    return buffer;
+}
+
+Napi::Object SynthesisEngine::synthesis_with_timing(
+    Napi::Env env,
+    Napi::Object query,
+    long speaker_id,
+    bool enable_interrogative_upspeak,
+    const SynthesisOptions &options
+) {
+    StageTimer timer;
+    DecodeRequest request = create_decode_request(
+        env, query, speaker_id, enable_interrogative_upspeak, options.direct_silence
+    );
+    timer.record(LATENCY_FRAMES);
+    bool g711 = is_g711_format(options.format);
+    SilenceLength silence;
+    std::vector<float> wave = output_wave(request, !g711, silence, timer);
+
+    int wave_sampling_rate = g711 ? default_sampling_rate : request.output_sampling_rate;
+    int timing_sampling_rate = g711 ? G711_SAMPLING_RATE : request.output_sampling_rate;
+    // 位置は切り詰める前の無音を基準に求める
+    SilenceLength decoded_silence = silence;
+    size_t trim_start, trim_end;
+    post_process(options.post_process, wave_sampling_rate, wave, silence, trim_start, trim_end, timer);
+    SynthesisTiming timing = output_timing(
+        request,
+        decoded_silence,
+        wave_sampling_rate,
+        trim_start,
+        trim_end,
+        timing_sampling_rate
+    );
+
+    Napi::Buffer<char> buffer = write_wave(
+        env,
+        wave,
+        silence,
+        options.format,
+        request.output_stereo,
+        request.output_sampling_rate,
+        request.volume_scale
+    );
+    timer.record(LATENCY_ENCODE);
+    add_synthesis_metrics(wave, silence, wave_sampling_rate, timer);
+
+    Napi::Array phonemes = Napi::Array::New(env, request.phonemes.size());
+    for (size_t i = 0; i < request.phonemes.size(); i++) {
+        phonemes[i] = Napi::String::New(env, request.phonemes[i]);
+    }
+    Napi::Uint32Array phoneme_timings = Napi::Uint32Array::New(env, timing.phonemes.size());
+    std::copy(timing.phonemes.begin(), timing.phonemes.end(), phoneme_timings.Data());
+    Napi::Uint32Array mora_timings = Napi::Uint32Array::New(env, timing.moras.size());
+    std::copy(timing.moras.begin(), timing.moras.end(), mora_timings.Data());
+    Napi::Object stage_timings = Napi::Object::New(env);
+    for (const std::pair<std::string, double> &stage : timer.stages()) {
+        stage_timings.Set(stage.first, Napi::Number::New(env, stage.second));
+    }
+
+    Napi::Object result = Napi::Object::New(env);
+    result.Set("wave", buffer);
+    result.Set("sampling_rate", Napi::Number::New(env, timing_sampling_rate));
+    result.Set("phonemes", phonemes);
+    result.Set("phoneme_timings", phoneme_timings);
+    result.Set("mora_timings", mora_timings);
+    result.Set("stage_timings", stage_timings);
+    return result;
+}
+
+Napi::Buffer<char> SynthesisEngine::write_wave(
+    Napi::Env env,
+    const std::vector<float> &wave,
+    const SilenceLength &silence,
+    WaveFormat format,
+    bool output_stereo,
+    int output_sampling_rate,
+    float volume_scale
+) {
+    bool g711 = is_g711_format(format);
+    WaveWriter writer(format, output_stereo ? 2 : 1, g711 ? default_sampling_rate : output_sampling_rate);
+    writer.set_silence(silence.leading, silence.trailing);
+    if (!writer.has_fixed_size()) {
+        std::vector<char> output = writer.write(wave, volume_scale);
+        return Napi::Buffer<char>::Copy(env, output.data(), output.size());
     }
 
-    // workaround of Hiroshiba/voicevox_engine#128
-    size_t offset = (size_t)((float)default_sampling_rate * (pre_padding_length / speed_scale));
-    for (size_t i = offset; i < wave.size(); i++) {
-        float v = wave[i] * volume_scale;
-        // clip
-        v = 1.0 < v ? 1.0 : v;
-        v = -1.0 > v ? -1.0 : v;
-        int16_t data = (int16_t)(v * (float)0x7fff);
-        for (int j = 0; j < repeat_count; j++) {
-            ss.put((char)(data & 0xff));
-            ss.put((char)((data & 0xff00) >> 8));
+    Napi::Buffer<char> buffer = Napi::Buffer<char>::New(env, writer.output_size(wave.size()));
+    // 音量の調整、クリップ、量子化、チャンネルの複製を一度に行い、Bufferへ直接書き込む
+    writer.write(wave.data(), wave.size(), volume_scale, buffer.Data());
+
+    return buffer;
+}
+
+SynthesisTiming SynthesisEngine::output_timing(
+    const DecodeRequest &request,
+    const SilenceLength &silence,
+    int sampling_rate,
+    size_t trim_start,
+    size_t trim_end,
+    int timing_sampling_rate
+) {
+    // output_waveと同じく、先頭の余白を除いてからsampling_rateに合わせる
+    double offset = (double)(size_t)((float)default_sampling_rate * request.pre_padding_length);
+    size_t num_phonemes = request.phonemes.size();
+    std::vector<uint32_t> boundaries(num_phonemes + 1);
+    for (size_t i = 1; i < num_phonemes; i++) {
+        double position = std::max((double)request.phoneme_frames[i] * 256 - offset, 0.0);
+        position = std::round(position * sampling_rate / default_sampling_rate) + silence.leading;
+        position = std::min(std::max(position, (double)trim_start), (double)trim_end) - trim_start;
+        boundaries[i] = (uint32_t)std::round(position * timing_sampling_rate / sampling_rate);
+    }
+    boundaries[0] = 0;
+    // 最後のpauは、後ろに書き込む無音も含めて音声の終わりまで続く
+    boundaries[num_phonemes] = (uint32_t)std::round((double)(trim_end - trim_start) * timing_sampling_rate / sampling_rate);
+
+    SynthesisTiming timing;
+    for (size_t i = 0; i < num_phonemes; i++) {
+        timing.phonemes.push_back(boundaries[i]);
+        timing.phonemes.push_back(boundaries[i + 1]);
+    }
+    for (const std::pair<size_t, size_t> &mora : request.mora_phonemes) {
+        timing.moras.push_back(boundaries[mora.first]);
+        timing.moras.push_back(boundaries[mora.second + 1]);
+    }
+    return timing;
+}
+
+// 0からcount-1までをCPUのスレッド数まで並列に処理する。最初に起きた例外は呼び出し元で投げ直す
+static void parallel_for(size_t count, const std::function<void(size_t)> &func) {
+    size_t num_threads = std::min((size_t)std::max(std::thread::hardware_concurrency(), 1u), count);
+    if (num_threads <= 1) {
+        for (size_t i = 0; i < count; i++) func(i);
+        return;
+    }
+
+    std::mutex mutex;
+    size_t next = 0;
+    std::exception_ptr error;
+    auto worker = [&]() {
+        while (true) {
+            size_t i;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (next >= count || error) return;
+                i = next++;
+            }
+            try {
+                func(i);
+            }
+            catch (...) {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (!error) error = std::current_exception();
+            }
         }
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < num_threads; i++) {
+        threads.emplace_back(worker);
     }
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+    if (error) std::rethrow_exception(error);
+}
 
-    size_t last_p = ss.tellp();
-    last_p -= 8;
-    ss.seekp(4);
-    for (int i = 0; i < 4; i++) {
-        ss.put((char)(last_p & 0xff));
-        last_p >>= 8;
+Napi::Buffer<char> SynthesisEngine::synthesis_concat(
+    Napi::Env env,
+    const std::vector<SynthesisSegment> &segments,
+    bool enable_interrogative_upspeak,
+    const SynthesisOptions &options
+) {
+    if (segments.empty()) {
+        throw std::runtime_error("no segments to synthesis");
+    }
+
+    // Napi::Objectを読むのはメインスレッドで済ませる
+    StageTimer timer;
+    std::vector<DecodeRequest> requests;
+    for (const SynthesisSegment &segment : segments) {
+        requests.push_back(create_decode_request(
+            env, segment.query, segment.speaker_id, enable_interrogative_upspeak, options.direct_silence
+        ));
+    }
+    timer.record(LATENCY_FRAMES);
+
+    bool g711 = is_g711_format(options.format);
+    int sampling_rate = g711 ? default_sampling_rate : requests[0].output_sampling_rate;
+    for (DecodeRequest &request : requests) {
+        request.output_sampling_rate = sampling_rate;
+    }
+
+    std::vector<std::vector<float>> waves(requests.size());
+    std::vector<SilenceLength> silences(requests.size());
+    parallel_for(requests.size(), [&](size_t i) {
+        StageTimer segment_timer;
+        waves[i] = output_wave(requests[i], !g711, silences[i], segment_timer);
+    });
+
+    std::vector<size_t> silence_after(requests.size(), 0);
+    size_t total = 0;
+    for (size_t i = 0; i < requests.size(); i++) {
+        if (i + 1 < requests.size()) {
+            silence_after[i] = (size_t)std::round(std::max(segments[i].silence_after, 0.0f) * sampling_rate);
+        }
+        total += silences[i].leading + waves[i].size() + silences[i].trailing + silence_after[i];
     }
-    ss.seekp(data_p);
-    size_t pointer = last_p - data_p - 4;
-    for (int i = 0; i < 4; i++) {
-        ss.put((char)(pointer & 0xff));
-        pointer >>= 8;
+
+    // 区間ごとに音量が違うので、ここで掛けてから1つの波形にまとめる
+    std::vector<float> joined(total, 0.0f);
+    size_t position = 0;
+    for (size_t i = 0; i < requests.size(); i++) {
+        position += silences[i].leading;
+        float volume_scale = requests[i].volume_scale;
+        for (float value : waves[i]) {
+            joined[position++] = value * volume_scale;
+        }
+        std::vector<float>().swap(waves[i]);
+        position += silences[i].trailing + silence_after[i];
     }
 
-    ss.seekg(0, std::ios::end);
-    int size = (int)ss.tellg();
-    ss.seekg(0, std::ios::beg);
+    // 区間ごとの復号は各スレッドで記録したので、繋げた後から計測を再開する
+    timer.restart();
+    // 切り詰めは全体の前後だけにかけ、正規化は全体で1つの利得にする
+    SilenceLength silence;
+    size_t trim_start, trim_end;
+    post_process(options.post_process, sampling_rate, joined, silence, trim_start, trim_end, timer);
 
-    return Napi::Buffer<char>::Copy(env, ss.str().c_str(), size);
+    // 音量は掛けてあり、無音もjoinedに含まれている
+    Napi::Buffer<char> buffer = write_wave(
+        env, joined, silence, options.format, requests[0].output_stereo, sampling_rate, 1.0f
+    );
+    timer.record(LATENCY_ENCODE);
+    add_synthesis_metrics(joined, silence, sampling_rate, timer);
+    return buffer;
 }
 
-std::vector<float> SynthesisEngine::synthesis(Napi::Env env, Napi::Object query, int64_t speaker_id, bool enable_interrogative_upspeak) {
+DecodeRequest SynthesisEngine::create_decode_request(
+    Napi::Env env,
+    Napi::Object query,
+    int64_t speaker_id,
+    bool enable_interrogative_upspeak,
+    bool direct_silence
+) {
     float rate = 200;
+    DecodeRequest request;
+    request.speaker_id = speaker_id;
+    request.volume_scale = query.Get("volumeScale").As<Napi::Number>().FloatValue();
+    request.output_sampling_rate = query.Get("outputSamplingRate").As<Napi::Number>().Int32Value();
+    request.output_stereo = query.Get("outputStereo").As<Napi::Boolean>().Value();
+    request.direct_silence = direct_silence;
+    request.pre_padding_length = pre_padding_length(speaker_id);
 
     Napi::Array accent_phrases = query.Get("accent_phrases").As<Napi::Array>();
     if (enable_interrogative_upspeak) {
@@ -482,9 +732,17 @@ std::vector<float> SynthesisEngine::synthesis(Napi::Env env, Napi::Object query,
 
     float pre_phoneme_length = query.Get("prePhonemeLength").As<Napi::Number>().FloatValue();
     float post_phoneme_length = query.Get("postPhonemeLength").As<Napi::Number>().FloatValue();
+    request.pre_phoneme_length = pre_phoneme_length;
+    request.post_phoneme_length = post_phoneme_length;
+    if (direct_silence) {
+        // 残りは出力時に0のサンプルとして書き込む
+        pre_phoneme_length = std::min(pre_phoneme_length, DIRECT_SILENCE_MARGIN);
+        post_phoneme_length = std::min(post_phoneme_length, DIRECT_SILENCE_MARGIN);
+    }
 
     float pitch_scale = query.Get("pitchScale").As<Napi::Number>().FloatValue();
     float speed_scale = query.Get("speedScale").As<Napi::Number>().FloatValue();
+    request.speed_scale = speed_scale;
     float intonation_scale = query.Get("intonationScale").As<Napi::Number>().FloatValue();
 
     std::vector<float> phoneme_length_list;
@@ -529,16 +787,22 @@ std::vector<float> SynthesisEngine::synthesis(Napi::Env env, Napi::Object query,
     split_mora(phoneme_data_list, consonant_phoneme_data_list, vowel_phoneme_data_list, vowel_indexes);
 
     // workaround of Hiroshiba/voicevox_engine#128
-    phoneme_length_list[0] += pre_padding_length;
+    // 校正した余白より短くならないよう、余白はspeed_scaleで割らずに先頭のpauへ足す
+    int pre_padding_frames = (int)std::round(request.pre_padding_length * rate);
 
     std::vector<std::vector<float>> phoneme;
     std::vector<float> f0;
+    // 音素ごとの、rateでのフレームの開始位置
+    std::vector<int> phoneme_starts;
     int phoneme_length_sum = 0;
     int f0_count = 0;
     long *p_vowel_index = vowel_indexes.data();
     for (size_t i = 0; i < phoneme_length_list.size(); i++) {
         int phoneme_length = (int)std::round((std::round(phoneme_length_list[i] * rate) / speed_scale));
+        if (i == 0) phoneme_length += pre_padding_frames;
         long phoneme_id = phoneme_data_list[i].phoneme_id();
+        phoneme_starts.push_back((int)phoneme.size());
+        request.phonemes.push_back(phoneme_data_list[i].phoneme);
         for (int j = 0; j < phoneme_length; j++) {
             std::vector<float> phonemes_vector(OjtPhoneme::num_phoneme(), 0.0);
             phonemes_vector[phoneme_id] = 1;
@@ -555,16 +819,45 @@ std::vector<float> SynthesisEngine::synthesis(Napi::Env env, Napi::Object query,
         }
     }
 
-    f0 = resample(f0, rate, 24000 / 256);
-    std::vector<float> flatten_phoneme = resample(phoneme, rate, 24000 / 256);
+    // f0と音素は同じ位置で間引き、フレームがずれないようにする
+    float offset = resample_offset();
+    request.f0 = resample(f0, resample_indexes(f0.size(), rate, 24000 / 256, offset));
+    std::vector<int> indexes = resample_indexes(phoneme.size(), rate, 24000 / 256, offset);
+    request.phoneme = resample(phoneme, indexes);
+
+    // 間引いた後のフレームで、各音素が最初に現れる位置
+    for (int start : phoneme_starts) {
+        request.phoneme_frames.push_back(
+            std::lower_bound(indexes.begin(), indexes.end(), start) - indexes.begin()
+        );
+    }
+    request.phoneme_frames.push_back(indexes.size());
+
+    // 先頭のpauの次から、子音があれば子音、母音の順に並んでいる
+    size_t phoneme_index = 1;
+    for (Napi::Object mora : flatten_moras) {
+        size_t first = phoneme_index;
+        if (mora.Get("consonant").IsString()) phoneme_index++;
+        request.mora_phonemes.push_back(std::make_pair(first, phoneme_index));
+        phoneme_index++;
+    }
+    return request;
+}
+
+std::vector<float> SynthesisEngine::decode(const DecodeRequest &request) {
+    // decode_forwardはconstでない配列を受け取るので、複数のスレッドから使えるよう複製する
+    std::vector<float> f0 = request.f0;
+    std::vector<float> phoneme = request.phoneme;
+    long speaker_id = (long)request.speaker_id;
 
     std::vector<float> wave(f0.size() * 256, 0.0);
+    TraceScope trace("decode_forward");
     bool success = m_core->decode_forward(
         f0.size(),
         OjtPhoneme::num_phoneme(),
         f0.data(),
-        flatten_phoneme.data(),
-        (long *)&speaker_id,
+        phoneme.data(),
+        &speaker_id,
         wave.data()
     );
 
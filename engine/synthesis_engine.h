@@ -2,38 +2,84 @@
 #define SYNTHESIS_ENGINE_H
 
 #include <string>
+#include <utility>
 #include <vector>
 
 #include <napi.h>
 
 #include "acoustic_feature_extractor.h"
+#include "g711.h"
+#include "openjtalk.h"
+#include "post_process.h"
+#include "pre_padding.h"
+#include "stage_timer.h"
+#include "wave_resampler.h"
+#include "wave_writer.h"
 #include "../core/core.h"
 
-static std::vector<std::string> unvoiced_mora_phoneme_list = {
-    "A", "I", "U", "E", "O", "cl", "pau"
-};
-
-static std::vector<std::string> mora_phoneme_list = {
-    "a", "i", "u", "e", "o", "N", "A", "I", "U", "E", "O", "cl", "pau"
-};
+// outputSamplingRateとして受け付ける範囲
+constexpr int MIN_OUTPUT_SAMPLING_RATE = 8000;
+constexpr int MAX_OUTPUT_SAMPLING_RATE = 192000;
+// directSilenceを指定した場合に、prePhonemeLengthとpostPhonemeLengthのうち復号する長さ
+constexpr float DIRECT_SILENCE_MARGIN = 0.1f;
 
 std::vector<Napi::Object> to_flatten_moras(Napi::Array accent_phrases);
-std::vector<OjtPhoneme> to_phoneme_data_list(std::vector<std::string> phoneme_str_list);
-void split_mora(
-    std::vector<OjtPhoneme> phoneme_list,
-    std::vector<OjtPhoneme> &consonant_phoneme_list,
-    std::vector<OjtPhoneme> &vowel_phoneme_list,
-    std::vector<long> &vowel_indexes
-);
 Napi::Array adjust_interrogative_accent_phrases(Napi::Env env, Napi::Array accent_phrases);
 Napi::Array adjust_interrogative_moras(Napi::Env env, Napi::Object accent_phrase);
 Napi::Object make_interrogative_mora(Napi::Env env, Napi::Object last_mora);
 
+// synthesisのoptionsで指定する設定
+struct SynthesisOptions {
+    WaveFormat format = WAVE_FORMAT_WAV_INT16;
+    bool direct_silence = false;
+    PostProcessOptions post_process;
+};
+
+// 復号を省き、出力時に書き込む前後の無音のサンプル数
+struct SilenceLength {
+    size_t leading = 0;
+    size_t trailing = 0;
+};
+
+// 1つの音声の復号と、その後の処理に必要な値
+// Napiに依存しないので、Napi::Objectから作った後は別のスレッドで復号できる
+struct DecodeRequest {
+    int64_t speaker_id;
+    std::vector<float> f0;
+    // フレームごとの音素のone-hotを並べたもの
+    std::vector<float> phoneme;
+    float speed_scale;
+    float volume_scale;
+    float pre_phoneme_length;
+    float post_phoneme_length;
+    float pre_padding_length;
+    int output_sampling_rate;
+    bool output_stereo;
+    bool direct_silence;
+    // 音素の名前と、phonemeのフレームでの開始位置。phoneme_framesの末尾には全体のフレーム数が入る
+    std::vector<std::string> phonemes;
+    std::vector<size_t> phoneme_frames;
+    // モーラ(pause_moraを含む)ごとの、phonemesでの最初と最後の位置
+    std::vector<std::pair<size_t, size_t>> mora_phonemes;
+};
+
+// 出力する音声での、音素とモーラの開始と終了のサンプル位置を交互に並べたもの
+struct SynthesisTiming {
+    std::vector<uint32_t> phonemes;
+    std::vector<uint32_t> moras;
+};
+
+// synthesis_concatで繋げる1つの区間
+struct SynthesisSegment {
+    Napi::Object query;
+    int64_t speaker_id;
+    // 次の区間との間に入れる無音(秒)
+    float silence_after;
+};
+
 class SynthesisEngine {
 public:
     const int default_sampling_rate = 24000;
-    // workaround of Hiroshiba/voicevox_engine#128
-    const float pre_padding_length = 0.4;
 
     SynthesisEngine(Core *core, OpenJTalk* openjtalk) {
         m_core = core;
@@ -41,17 +87,94 @@ public:
     }
     void update_openjtalk(OpenJTalk *openjtalk) { m_openjtalk = openjtalk; }
 
-    Napi::Array create_accent_phrases(Napi::Env env, Napi::String text, Napi::Number speaker_id);
+    // openjtalkを省略した場合は、コンストラクタで渡された辞書を使う
+    Napi::Array create_accent_phrases(Napi::Env env, Napi::String text, Napi::Number speaker_id, OpenJTalk *openjtalk = nullptr);
     Napi::Array replace_mora_data(Napi::Array accent_phrases, long speaker_id);
     Napi::Array replace_phoneme_length(Napi::Array accent_phrases, int64_t speaker_id);
     Napi::Array replace_mora_pitch(Napi::Array accent_phrases, int64_t speaker_id);
     Napi::Array synthesis_array(Napi::Env env, Napi::Object query, long speaker_id, bool enable_interrogative_upspeak = true);
-    Napi::Buffer<char> synthesis_wave_format(Napi::Env env, Napi::Object query, long speaker_id, bool enable_interrogative_upspeak = true);
+    // 話者の先頭の余白を校正して以降の合成で使い、その長さを返す
+    float calibrate_pre_padding(int64_t speaker_id);
+    float pre_padding_length(int64_t speaker_id) const { return m_pre_padding.get(speaker_id); }
+    Napi::Buffer<char> synthesis_wave_format(
+        Napi::Env env,
+        Napi::Object query,
+        long speaker_id,
+        bool enable_interrogative_upspeak = true,
+        const SynthesisOptions &options = SynthesisOptions()
+    );
+    // 音声と一緒に、音素とモーラの開始と終了のサンプル位置と、段階ごとの処理時間を返す
+    Napi::Object synthesis_with_timing(
+        Napi::Env env,
+        Napi::Object query,
+        long speaker_id,
+        bool enable_interrogative_upspeak = true,
+        const SynthesisOptions &options = SynthesisOptions()
+    );
+    // 複数のクエリを並列に合成し、1つの音声として書き込む
+    // コアライブラリの呼び出しはCoreの中で直列になるので、並列になるのはその前後の処理のみ
+    // 出力の周波数とチャンネル数は最初のクエリに合わせ、音量は区間ごとのものを使う
+    Napi::Buffer<char> synthesis_concat(
+        Napi::Env env,
+        const std::vector<SynthesisSegment> &segments,
+        bool enable_interrogative_upspeak = true,
+        const SynthesisOptions &options = SynthesisOptions()
+    );
 private:
     Core *m_core;
     OpenJTalk* m_openjtalk;
+    PrePaddingTable m_pre_padding;
 
-    std::vector<float> synthesis(Napi::Env env, Napi::Object query, int64_t speaker_id, bool enable_interrogative_upspeak = true);
+    // direct_silenceがtrueの場合、前後の無音はDIRECT_SILENCE_MARGINまでしか復号しない
+    DecodeRequest create_decode_request(
+        Napi::Env env,
+        Napi::Object query,
+        int64_t speaker_id,
+        bool enable_interrogative_upspeak = true,
+        bool direct_silence = false
+    );
+    // 以下の2つはNapiを使わないので、別のスレッドから呼べる
+    std::vector<float> decode(const DecodeRequest &request);
+    // 先頭の余白を除き、outputSamplingRateに変換した波形(音量は未調整)
+    // resampleがfalseの場合はdefault_sampling_rateのまま返す
+    // direct_silenceの場合は、復号を省いた前後の無音のサンプル数をsilenceに入れる
+    // 復号と周波数の変換にかかった時間をtimerに記録する
+    std::vector<float> output_wave(
+        const DecodeRequest &request,
+        bool resample,
+        SilenceLength &silence,
+        StageTimer &timer
+    );
+    // 切り詰めと音量の正規化をwaveにかける。切り詰めた場合は前後の無音も除く
+    // 前後の無音を含めた元の波形のうち、残した範囲を[trim_start, trim_end)に入れる
+    void post_process(
+        const PostProcessOptions &options,
+        int sampling_rate,
+        std::vector<float> &wave,
+        SilenceLength &silence,
+        size_t &trim_start,
+        size_t &trim_end,
+        StageTimer &timer
+    );
+    // sampling_rateの前後の無音を含む波形での位置を求め、[trim_start, trim_end)の範囲に切り詰めてから
+    // timing_sampling_rateに換算する
+    SynthesisTiming output_timing(
+        const DecodeRequest &request,
+        const SilenceLength &silence,
+        int sampling_rate,
+        size_t trim_start,
+        size_t trim_end,
+        int timing_sampling_rate
+    );
+    Napi::Buffer<char> write_wave(
+        Napi::Env env,
+        const std::vector<float> &wave,
+        const SilenceLength &silence,
+        WaveFormat format,
+        bool output_stereo,
+        int output_sampling_rate,
+        float volume_scale
+    );
     void initail_process(
         Napi::Array accent_phrases,
         std::vector<Napi::Object> &flatten_moras,
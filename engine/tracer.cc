@@ -0,0 +1,119 @@
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "nlohmann/json.hpp"
+#include "tracer.h"
+
+// スレッドごとに保持する区間の数。溢れた場合は古いものから上書きする
+constexpr size_t TRACE_BUFFER_SIZE = 16384;
+
+struct TraceEvent {
+    const char *name;
+    uint32_t thread_id;
+    int64_t start_ns;
+    int64_t duration_ns;
+};
+
+// スレッドごとのリングバッファ。mutexは書き込むスレッドとdump_traceの間でしか取り合わない
+struct TraceBuffer {
+    std::mutex mutex;
+    std::vector<TraceEvent> events;
+    size_t next = 0;
+    bool wrapped = false;
+    // スレッドの終了後は、後から作られたスレッドが記録を残したまま使い回す
+    bool in_use = false;
+};
+
+std::atomic<bool> tracing_active(false);
+
+static std::mutex buffers_mutex;
+static std::vector<std::unique_ptr<TraceBuffer>> buffers;
+static std::atomic<uint32_t> next_thread_id(1);
+static const std::chrono::steady_clock::time_point trace_epoch = std::chrono::steady_clock::now();
+
+static TraceBuffer *acquire_buffer() {
+    std::lock_guard<std::mutex> lock(buffers_mutex);
+    for (std::unique_ptr<TraceBuffer> &buffer : buffers) {
+        if (!buffer->in_use) {
+            buffer->in_use = true;
+            return buffer.get();
+        }
+    }
+    buffers.push_back(std::unique_ptr<TraceBuffer>(new TraceBuffer()));
+    buffers.back()->events.resize(TRACE_BUFFER_SIZE);
+    buffers.back()->in_use = true;
+    return buffers.back().get();
+}
+
+class ThreadTraceBuffer {
+public:
+    TraceBuffer *buffer = nullptr;
+    uint32_t thread_id = next_thread_id.fetch_add(1, std::memory_order_relaxed);
+
+    ~ThreadTraceBuffer() {
+        if (buffer == nullptr) return;
+        std::lock_guard<std::mutex> lock(buffers_mutex);
+        buffer->in_use = false;
+    }
+};
+
+static thread_local ThreadTraceBuffer thread_buffer;
+
+void start_tracing() {
+    tracing_active.store(true, std::memory_order_relaxed);
+}
+
+void stop_tracing() {
+    tracing_active.store(false, std::memory_order_relaxed);
+}
+
+void trace_complete(
+    const char *name,
+    std::chrono::steady_clock::time_point start,
+    std::chrono::steady_clock::time_point end
+) {
+    if (thread_buffer.buffer == nullptr) thread_buffer.buffer = acquire_buffer();
+    TraceBuffer *buffer = thread_buffer.buffer;
+
+    TraceEvent event;
+    event.name = name;
+    event.thread_id = thread_buffer.thread_id;
+    event.start_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(start - trace_epoch).count();
+    event.duration_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+
+    std::lock_guard<std::mutex> lock(buffer->mutex);
+    buffer->events[buffer->next] = event;
+    buffer->next = (buffer->next + 1) % buffer->events.size();
+    if (buffer->next == 0) buffer->wrapped = true;
+}
+
+std::string dump_trace() {
+    nlohmann::json events = nlohmann::json::array();
+    std::lock_guard<std::mutex> buffers_lock(buffers_mutex);
+    for (std::unique_ptr<TraceBuffer> &buffer : buffers) {
+        std::lock_guard<std::mutex> lock(buffer->mutex);
+        size_t size = buffer->wrapped ? buffer->events.size() : buffer->next;
+        size_t first = buffer->wrapped ? buffer->next : 0;
+        for (size_t i = 0; i < size; i++) {
+            const TraceEvent &event = buffer->events[(first + i) % buffer->events.size()];
+            events.push_back({
+                {"name", event.name},
+                {"cat", "engine"},
+                {"ph", "X"},
+                {"ts", (double)event.start_ns / 1000.0},
+                {"dur", (double)event.duration_ns / 1000.0},
+                {"pid", 1},
+                {"tid", event.thread_id},
+            });
+        }
+        buffer->next = 0;
+        buffer->wrapped = false;
+    }
+
+    nlohmann::json trace;
+    trace["traceEvents"] = events;
+    trace["displayTimeUnit"] = "ms";
+    return trace.dump();
+}
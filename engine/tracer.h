@@ -0,0 +1,46 @@
+#ifndef TRACER_H
+#define TRACER_H
+
+#include <atomic>
+#include <chrono>
+#include <string>
+
+// 処理の区間を、Chromeのtrace event形式(chrome://tracingやPerfettoで開ける)で記録する
+// 無効な間は、区間ごとにフラグを1回読むだけで何も記録しない
+extern std::atomic<bool> tracing_active;
+
+inline bool tracing_enabled() {
+    return tracing_active.load(std::memory_order_relaxed);
+}
+
+void start_tracing();
+void stop_tracing();
+// 記録した区間をJSONで返し、記録を空にする
+std::string dump_trace();
+
+// nameは文字列リテラルなど、プロセスの終了まで有効な文字列を渡す
+void trace_complete(
+    const char *name,
+    std::chrono::steady_clock::time_point start,
+    std::chrono::steady_clock::time_point end
+);
+
+// 作成からスコープを抜けるまでを1つの区間として記録する
+class TraceScope {
+public:
+    explicit TraceScope(const char *name) : m_name(name), m_active(tracing_enabled()) {
+        if (m_active) m_start = std::chrono::steady_clock::now();
+    }
+    ~TraceScope() {
+        if (m_active) trace_complete(m_name, m_start, std::chrono::steady_clock::now());
+    }
+    TraceScope(const TraceScope &) = delete;
+    TraceScope &operator=(const TraceScope &) = delete;
+
+private:
+    const char *m_name;
+    bool m_active;
+    std::chrono::steady_clock::time_point m_start;
+};
+
+#endif // TRACER_H
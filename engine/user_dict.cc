@@ -1,11 +1,15 @@
 #include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
 #include <iostream>
-#include <regex>
 
+#include "engine_metrics.h"
+#include "mora_list.h"
+#include "probes.h"
+#include "tracer.h"
 #include "uuid_v4.h"
 #include "user_dict.h"
-#include "kana_parser.h"
-#include "part_of_speech_data.h"
 
 void write_to_json(json user_dict, std::string user_dict_path) {
     json converted_user_dict = json::object();
@@ -17,76 +21,111 @@ void write_to_json(json user_dict, std::string user_dict_path) {
         converted_user_dict[word_uuid] = word_dict;
     }
     std::string user_dict_json = converted_user_dict.dump();
-    std::ofstream output_file(user_dict_path);
+    // 書き込み途中のファイルを読まれないよう、別名で書いてから置き換える
+    std::string temp_path = user_dict_path + "." + uuid_v4();
+    std::ofstream output_file(temp_path);
     output_file << user_dict_json;
+    output_file.close();
+    if (!output_file || !replace_file(temp_path, user_dict_path)) {
+        std::remove(temp_path.c_str());
+        throw std::runtime_error("failed to write user dictionary");
+    }
 }
 
-OpenJTalk *user_dict_startup_processing(OpenJTalk *openjtalk) {
-    std::string default_dict_path = openjtalk->default_dict_path;
-    std::string user_dict_path = openjtalk->user_dict_path;
-    create_user_dict(openjtalk->dn_mecab, openjtalk->default_dict_path, openjtalk->user_mecab);
-    openjtalk->clear();
-    openjtalk = new OpenJTalk(openjtalk->dn_mecab, openjtalk->user_mecab);
-    openjtalk->default_dict_path = default_dict_path;
-    openjtalk->user_dict_path = user_dict_path;
-    return openjtalk;
+static std::vector<std::string> read_csv_rows(std::ifstream &csv_file) {
+    std::vector<std::string> csv_rows;
+    std::string row;
+    while (std::getline(csv_file, row)) {
+        if (!row.empty() && row.back() == '\r') row.pop_back();
+        if (!row.empty()) csv_rows.push_back(row);
+    }
+    return csv_rows;
+}
+
+std::string word_to_csv_row(const json &word) {
+    return (
+        word.at("surface").get<std::string>() + "," +
+        std::to_string(word.at("context_id").get<int>()) + "," +
+        std::to_string(word.at("context_id").get<int>()) + "," +
+        std::to_string(priority2cost(word.at("context_id").get<int>(), word.at("priority").get<int>())) + "," +
+        word.at("part_of_speech").get<std::string>() + "," +
+        word.at("part_of_speech_detail_1").get<std::string>() + "," +
+        word.at("part_of_speech_detail_2").get<std::string>() + "," +
+        word.at("part_of_speech_detail_3").get<std::string>() + "," +
+        word.at("inflectional_type").get<std::string>() + "," +
+        word.at("inflectional_form").get<std::string>() + "," +
+        word.at("stem").get<std::string>() + "," +
+        word.at("yomi").get<std::string>() + "," +
+        word.at("pronunciation").get<std::string>() + "," +
+        std::to_string(word.at("accent_type").get<int>()) + "/" +
+        std::to_string(word.at("mora_count").get<int>()) + "," +
+        word.at("accent_associative_rule").get<std::string>()
+    );
 }
 
 OpenJTalk *update_dict(OpenJTalk *openjtalk) {
-    std::string temp_path = std::tmpnam(nullptr);
-    std::ofstream temp_file(temp_path);
-    std::ifstream default_dict_file(openjtalk->default_dict_path);
-    if (!default_dict_file) {
-        std::cout << "Warning: Cannot find default dictionary." << std::endl;
-        return openjtalk;
-    }
-    std::string default_dict((std::istreambuf_iterator<char>(default_dict_file)), std::istreambuf_iterator<char>());
-    if (default_dict[default_dict.size() - 1] != '\n') {
-        default_dict += "\n";
-    }
-    temp_file << default_dict;
+    TraceScope trace("update_dict");
+    ENGINE_PROBE0(update_dict_entry);
+    // 例外で抜けた場合も、successをfalseにしてupdate_dict_returnを発火させる
+    struct ReturnProbe {
+        size_t words = 0;
+        size_t rows = 0;
+        bool success = false;
+        ~ReturnProbe() { ENGINE_PROBE3(update_dict_return, words, rows, success); }
+    } return_probe;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    // 既定の辞書はcompile_default_dictでコンパイル済みなので、この名前空間の単語のみをコンパイルする
+    std::vector<std::string> csv_rows;
     json user_dict = read_dict(openjtalk->user_dict_path);
     for (auto &item : user_dict.items()) {
-        json &word = item.value();
-        std::string word_info = (
-            word["surface"].get<std::string>() + "," +
-            std::to_string(word["context_id"].get<int>()) + "," +
-            std::to_string(word["context_id"].get<int>()) + "," +
-            std::to_string(priority2cost(word["context_id"].get<int>(), word["priority"].get<int>())) + "," +
-            word["part_of_speech"].get<std::string>() + "," +
-            word["part_of_speech_detail_1"].get<std::string>() + "," +
-            word["part_of_speech_detail_2"].get<std::string>() + "," +
-            word["part_of_speech_detail_3"].get<std::string>() + "," +
-            word["inflectional_type"].get<std::string>() + "," +
-            word["inflectional_form"].get<std::string>() + "," +
-            word["stem"].get<std::string>() + "," +
-            word["yomi"].get<std::string>() + "," +
-            word["pronunciation"].get<std::string>() + "," +
-            std::to_string(word["accent_type"].get<int>()) + "/" +
-            std::to_string(word["mora_count"].get<int>()) + "," +
-            word["accent_associative_rule"].get<std::string>() + "\n"
-        );
-        temp_file << word_info;
+        csv_rows.push_back(word_to_csv_row(item.value()));
     }
-    temp_file.close();
-    std::string temp_dict_path = std::tmpnam(nullptr);
-    create_user_dict(openjtalk->dn_mecab, temp_path, temp_dict_path);
-    std::ifstream temp_dict_file(temp_dict_path, std::ios::in | std::ios::binary);
-    if (!temp_dict_file) {
-        throw std::runtime_error("An error occurred while compiling user dictionary.");
+    // 単語がない場合はコンパイルせず、既定の辞書のみを読み込む
+    std::string compiled_dict_path;
+    if (!csv_rows.empty()) {
+        compiled_dict_path = compile_user_dict(openjtalk->dn_mecab, csv_rows, openjtalk->user_mecab);
     }
-    std::string default_dict_path = openjtalk->default_dict_path;
-    std::string user_dict_path = openjtalk->user_dict_path;
-    std::string compiled_dict_path = openjtalk->user_mecab;
-    openjtalk->clear();
-    openjtalk = new OpenJTalk(openjtalk->dn_mecab);
-    std::ofstream compiled_dict_file(compiled_dict_path, std::ios::out | std::ios::trunc | std::ios::binary);
-    compiled_dict_file << temp_dict_file.rdbuf();
-    compiled_dict_file.close();
-    openjtalk->clear();
-    openjtalk = new OpenJTalk(openjtalk->dn_mecab, compiled_dict_path);
-    openjtalk->default_dict_path = default_dict_path;
+    openjtalk->install_user_dict(compiled_dict_path);
+    std::chrono::nanoseconds elapsed = std::chrono::steady_clock::now() - start;
+    engine_metrics().dict_rebuilt((uint64_t)elapsed.count());
+    return_probe.words = user_dict.size();
+    return_probe.rows = csv_rows.size();
+    return_probe.success = true;
+    return openjtalk;
+}
+
+std::string compile_default_dict(const std::string &dn_mecab, const std::string &default_dict_path, const std::string &out_path) {
+    TraceScope trace("compile_default_dict");
+    std::ifstream default_dict_file(default_dict_path);
+    if (!default_dict_file) {
+        std::cout << "Warning: Cannot find default dictionary." << std::endl;
+        return "";
+    }
+    std::vector<std::string> csv_rows = read_csv_rows(default_dict_file);
+    if (csv_rows.empty()) return "";
+
+    std::string compiled_dict_path = compile_user_dict(dn_mecab, csv_rows, out_path);
+    // 同じディレクトリを使う他のEngineが読み込んでいて置き換えられない場合は、既にあるものを使う
+    if (!replace_file(compiled_dict_path, out_path)) {
+        std::remove(compiled_dict_path.c_str());
+        if (!std::ifstream(out_path)) {
+            throw std::runtime_error("failed to install default dictionary");
+        }
+    }
+    return out_path;
+}
+
+std::shared_ptr<OpenJTalk> load_dict_namespace(
+    const std::string &dn_mecab,
+    const std::string &default_mecab,
+    const std::string &user_dict_path,
+    const std::string &user_mecab
+) {
+    std::shared_ptr<OpenJTalk> openjtalk = std::make_shared<OpenJTalk>(dn_mecab);
+    openjtalk->default_mecab = default_mecab;
     openjtalk->user_dict_path = user_dict_path;
+    openjtalk->user_mecab = user_mecab;
+    update_dict(openjtalk.get());
     return openjtalk;
 }
 
@@ -101,24 +140,48 @@ json read_dict(std::string user_dict_path) {
 
     for (auto &item : user_dict_json.items()) {
         json &word = item.value();
-        if (word.contains("context_id")) {
-            word["context_id"] = part_of_speech_data["PROPER_NOUN"]["context_id"];
+        if (!word.contains("context_id")) {
+            word["context_id"] = search_part_of_speech("PROPER_NOUN")->context_id;
         }
-        word["priority"] = cost2priority(word["context_id"], word["cost"]);
+        word["priority"] = cost2priority(word["context_id"].get<int>(), word["cost"].get<int>());
         word.erase("cost");
     }
 
     return user_dict_json;
 }
 
+// 半角の!(0x21)から~(0x7E)までと、全角の！(U+FF01)から～(U+FF5E)までのUTF-8表現の対応表
+static constexpr std::array<std::array<char, 3>, 94> create_zenkaku_table() {
+    std::array<std::array<char, 3>, 94> zenkaku_table{};
+    for (int i = 0; i < 94; i++) {
+        int code_point = 0xFF01 + i;
+        zenkaku_table[i][0] = (char)(0xE0 | (code_point >> 12));
+        zenkaku_table[i][1] = (char)(0x80 | ((code_point >> 6) & 0x3F));
+        zenkaku_table[i][2] = (char)(0x80 | (code_point & 0x3F));
+    }
+    return zenkaku_table;
+}
+
+static constexpr std::array<std::array<char, 3>, 94> zenkaku_table = create_zenkaku_table();
+
+// UTF-8のマルチバイト文字は全バイトが0x80以上なので、1バイトずつ見ていけば半角文字だけを置き換えられる
+static std::string hankaku_to_zenkaku(const std::string &text) {
+    std::string converted;
+    converted.reserve(text.size() * 3);
+    for (unsigned char c : text) {
+        if (0x21 <= c && c <= 0x7E) {
+            converted.append(zenkaku_table[c - 0x21].data(), 3);
+        } else {
+            converted.push_back((char)c);
+        }
+    }
+    return converted;
+}
+
 json create_word(std::string surface, std::string pronunciation, int accent_type, std::string *word_type, int *priority) {
     std::string word_type_str = word_type != nullptr ? *word_type : "PROPER_NOUN";
-    bool key_found = false;
-    for (auto item : part_of_speech_data.items()) {
-        key_found = word_type_str == item.key();
-        if (key_found) break;
-    }
-    if (!key_found) {
+    const PartOfSpeechDetail *pos_detail = search_part_of_speech(word_type_str);
+    if (pos_detail == nullptr) {
         throw std::runtime_error("invalid word type");
     }
     int priority_num = priority != nullptr ? *priority : 5;
@@ -128,36 +191,7 @@ json create_word(std::string surface, std::string pronunciation, int accent_type
 
     // hankaku to zenkaku
     // replace !(exclamation mark) to ~(tilde)
-    for (int i = 0; i < 94; i++) {
-        std::vector<unsigned char> hankaku{ (unsigned char)(0x21 + i) };
-        std::vector<unsigned char> zenkaku;
-        if (i < 63) zenkaku = { 0xEF, 0xBC, (unsigned char)(0x81 + i) };
-        else zenkaku = { 0xEF, 0xBD, (unsigned char)(0x80 + i - 63) };
-
-        std::string hankaku_str((char *)hankaku.data(), hankaku.size());
-        std::string zenkaku_str((char *)zenkaku.data(), zenkaku.size());
-        // 正規表現に使われる文字列はエスケープする
-        if (
-            hankaku_str == "$" ||
-            hankaku_str == "(" ||
-            hankaku_str == ")" ||
-            hankaku_str == "*" ||
-            hankaku_str == "+" ||
-            hankaku_str == "-" ||
-            hankaku_str == "." ||
-            hankaku_str == "?" ||
-            hankaku_str == "[" ||
-            hankaku_str == "\\" ||
-            hankaku_str == "]" ||
-            hankaku_str == "^" ||
-            hankaku_str == "{" ||
-            hankaku_str == "|" ||
-            hankaku_str == "}"
-        ) {
-            hankaku_str = "\\" + hankaku_str;
-        }
-        surface = std::regex_replace(surface, std::regex(hankaku_str), zenkaku_str);
-    }
+    surface = hankaku_to_zenkaku(surface);
 
     // check pronunciation
     size_t char_size;
@@ -165,16 +199,11 @@ json create_word(std::string surface, std::string pronunciation, int accent_type
     for (size_t pos = 0; pos < pronunciation.size(); pos += char_size) {
         std::string letter = extract_one_character(pronunciation, pos, char_size);
         matching_text += letter;
-        int counter = 0;
-        while (
-            std::find(mora_list_minimum.begin(), mora_list_minimum.end(), matching_text) == mora_list_minimum.end() &&
-            matching_text != "ー" // 伸ばし棒はmora listには含まれていないため
-        ) {
-            matching_text = letter;
-            counter++;
-            if (counter > 1) {
-                throw std::runtime_error("invalid pronunciation, pronunciation must be katakana");
-            }
+        // 伸ばし棒はmora listには含まれていないため
+        if (is_mora_text(matching_text) || matching_text == "ー") continue;
+        matching_text = letter;
+        if (!is_mora_text(matching_text) && matching_text != "ー") {
+            throw std::runtime_error("invalid pronunciation, pronunciation must be katakana");
         }
     }
     // 正規表現を用いたコードは環境によっては正しく動作しない
@@ -182,9 +211,9 @@ json create_word(std::string surface, std::string pronunciation, int accent_type
     // if (std::regex_match(pronunciation, all_katakana)) {
     //     throw std::runtime_error("invalid pronunciation, pronunciation must be katakana");
     // }
-    std::vector<std::string> sute_gana{"ァ", "ィ", "ゥ", "ェ", "ォ", "ャ", "ュ", "ョ", "ヮ", "ッ"};
-    std::vector<std::string> sute_gana_without_sokuon{"ァ", "ィ", "ゥ", "ェ", "ォ", "ャ", "ュ", "ョ", "ヮ"};
-    std::vector<std::string> small_wa_before{"ク", "グ"};
+    static const std::vector<std::string> sute_gana{"ァ", "ィ", "ゥ", "ェ", "ォ", "ャ", "ュ", "ョ", "ヮ", "ッ"};
+    static const std::vector<std::string> sute_gana_without_sokuon{"ァ", "ィ", "ゥ", "ェ", "ォ", "ャ", "ュ", "ョ", "ヮ"};
+    static const std::vector<std::string> small_wa_before{"ク", "グ"};
 
     // mora count
     int mora_count = 0;
@@ -229,15 +258,14 @@ json create_word(std::string surface, std::string pronunciation, int accent_type
         throw std::runtime_error("accent type is wrong");
     }
 
-    json pos_detail = part_of_speech_data[word_type_str];
     json result = {
         { "surface", surface },
-        { "context_id", pos_detail["context_id"].get<int>() },
+        { "context_id", pos_detail->context_id },
         { "priority", priority_num },
-        { "part_of_speech", pos_detail["part_of_speech"].get<std::string>() },
-        { "part_of_speech_detail_1", pos_detail["part_of_speech_detail_1"].get<std::string>() },
-        { "part_of_speech_detail_2", pos_detail["part_of_speech_detail_2"].get<std::string>() },
-        { "part_of_speech_detail_3", pos_detail["part_of_speech_detail_3"].get<std::string>() },
+        { "part_of_speech", pos_detail->part_of_speech },
+        { "part_of_speech_detail_1", pos_detail->part_of_speech_detail_1 },
+        { "part_of_speech_detail_2", pos_detail->part_of_speech_detail_2 },
+        { "part_of_speech_detail_3", pos_detail->part_of_speech_detail_3 },
         { "inflectional_type", "*" },
         { "inflectional_form", "*" },
         { "stem", "*" },
@@ -259,6 +287,7 @@ std::pair<std::string, OpenJTalk*> apply_word(
     int *priority
 ) {
     json word = create_word(surface, pronunciation, accent_type, word_type, priority);
+    std::lock_guard<std::mutex> lock(openjtalk->user_dict_mutex);
     json user_dict = read_dict(openjtalk->user_dict_path);
     std::string word_uuid = uuid_v4();
     user_dict[word_uuid] = word;
@@ -277,6 +306,7 @@ OpenJTalk *rewrite_word(
     int *priority
 ) {
     json word = create_word(surface, pronunciation, accent_type, word_type, priority);
+    std::lock_guard<std::mutex> lock(openjtalk->user_dict_mutex);
     json user_dict = read_dict(openjtalk->user_dict_path);
     user_dict[word_uuid] = word;
     write_to_json(user_dict, openjtalk->user_dict_path);
@@ -284,6 +314,7 @@ OpenJTalk *rewrite_word(
 }
 
 OpenJTalk *delete_word(OpenJTalk *openjtalk, std::string word_uuid) {
+    std::lock_guard<std::mutex> lock(openjtalk->user_dict_mutex);
     json user_dict = read_dict(openjtalk->user_dict_path);
     bool key_found = false;
     for (auto item : user_dict.items()) {
@@ -306,21 +337,19 @@ void import_user_dict(
 ) {
 }
 
-std::vector<int> search_cost_candidates(int context_id) {
-    for (auto &elem : part_of_speech_data.items()) {
-        auto &value = elem.value();
-        if (value["context_id"].get<int>() == context_id) {
-            return value["cost_candidates"].get<std::vector<int>>();
-        }
+const CostCandidates &search_cost_candidates(int context_id) {
+    const PartOfSpeechDetail *pos_detail = search_part_of_speech(context_id);
+    if (pos_detail == nullptr) {
+        throw std::runtime_error("invalid context id");
     }
-    throw std::runtime_error("invalid context id");
+    return pos_detail->cost_candidates;
 }
 
 int cost2priority(int context_id, int cost) {
     if (cost < -32768 || 32767 < cost) {
         throw std::runtime_error("invalid cost value");
     }
-    auto cost_candidates = search_cost_candidates(context_id);
+    const CostCandidates &cost_candidates = search_cost_candidates(context_id);
     int min_value = 0;
     int min_index = -1;
     for (int i = 0; i < cost_candidates.size(); i++) {
@@ -338,6 +367,6 @@ int priority2cost(int context_id, int priority) {
     if (priority < USER_DICT_MIN_PRIORITY || USER_DICT_MAX_PRIORITY < priority) {
         throw std::runtime_error("invalid priority value");
     }
-    auto cost_candidates = search_cost_candidates(context_id);
+    const CostCandidates &cost_candidates = search_cost_candidates(context_id);
     return cost_candidates[USER_DICT_MAX_PRIORITY - priority];
 }
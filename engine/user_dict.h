@@ -3,16 +3,31 @@
 
 #include <fstream>
 #include <iostream>
+#include <memory>
+#include <string>
 #include <vector>
 
 #include "nlohmann/json.hpp"
 #include "openjtalk.h"
+#include "part_of_speech_data.h"
 
 using json = nlohmann::json;
 
 void write_to_json(json user_dict, std::string user_dict_path);
-OpenJTalk *user_dict_startup_processing(OpenJTalk *openjtalk);
+// create_wordで作った単語を、MeCabの辞書のCSVの1行にする
+std::string word_to_csv_row(const json &word);
+// ユーザー辞書の単語のみをコンパイルし、既定の辞書と一緒に読み込み直す
 OpenJTalk *update_dict(OpenJTalk *openjtalk);
+// 既定の辞書(default.csv)をout_pathにコンパイルし、out_pathを返す。全ての名前空間で共有するので、起動時に1回だけ行う
+// 既定の辞書が見つからない場合は空文字列を返す
+std::string compile_default_dict(const std::string &dn_mecab, const std::string &default_dict_path, const std::string &out_path);
+// 名前空間の辞書を作る。コンパイルするのはuser_dict_pathの単語のみで、default_mecabはcompile_default_dictで作ったものを使う
+std::shared_ptr<OpenJTalk> load_dict_namespace(
+    const std::string &dn_mecab,
+    const std::string &default_mecab,
+    const std::string &user_dict_path,
+    const std::string &user_mecab
+);
 json read_dict(std::string user_dict_path);
 json create_word(std::string surface, std::string pronunciation, int accent_type, std::string *word_type = nullptr, int *priority = nullptr);
 std::pair<std::string, OpenJTalk*> apply_word(
@@ -35,7 +50,7 @@ OpenJTalk *rewrite_word(
 OpenJTalk *delete_word(OpenJTalk *openjtalk, std::string word_uuid);
 void import_user_dict(OpenJTalk *openjtalk, json dict_data, bool override);
 
-std::vector<int> search_cost_candidates(int context_id);
+const CostCandidates &search_cost_candidates(int context_id);
 int cost2priority(int context_id, int cost);
 int priority2cost(int context_id, int priority);
 
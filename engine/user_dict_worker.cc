@@ -0,0 +1,236 @@
+#include <algorithm>
+
+#include "engine_metrics.h"
+#include "user_dict_worker.h"
+#include "user_dict.h"
+#include "uuid_v4.h"
+
+UserDictWorker::UserDictWorker(Napi::Env env) : m_env(env) {
+    m_complete = Napi::ThreadSafeFunction::New(
+        env,
+        Napi::Function::New(env, [](const Napi::CallbackInfo&) {}),
+        "UserDictWorker",
+        0,
+        1
+    );
+    // 待っている変更がない間はイベントループを止めないようにする
+    m_complete.Unref(env);
+    m_thread = std::thread(&UserDictWorker::run, this);
+}
+
+UserDictWorker::~UserDictWorker() {
+    {
+        std::lock_guard<std::mutex> lock(m_queue_mutex);
+        m_stopping = true;
+    }
+    m_queue_cv.notify_one();
+    m_thread.join();
+
+    // Abortした後はスレッドセーフ関数の呼び出しが捨てられるので、ここで全てのPromiseを解決する
+    // 処理を終えた変更は結果を返し、まだ処理していない変更は拒否する
+    std::vector<std::vector<Mutation *> *> posted = m_posted;
+    std::vector<Mutation *> queued(m_queue.begin(), m_queue.end());
+    m_queue.clear();
+    Napi::HandleScope scope(m_env);
+    for (std::vector<Mutation *> *batch : posted) complete(m_env, batch);
+    for (Mutation *mutation : queued) {
+        // 環境の終了中に破棄された場合は拒否できないので、解放のみ行う
+        try {
+            mutation->deferred.Reject(Napi::Error::New(m_env, "engine destroyed").Value());
+        } catch (...) {
+        }
+        delete mutation;
+    }
+    m_pending_count -= queued.size();
+    engine_metrics().add_user_dict_queue(-(int64_t)queued.size());
+    m_complete.Abort();
+}
+
+Napi::Promise UserDictWorker::add_word(
+    Napi::Env env,
+    std::shared_ptr<OpenJTalk> openjtalk,
+    std::string surface,
+    std::string pronunciation,
+    int accent_type,
+    std::string *word_type,
+    int *priority
+) {
+    Mutation *mutation = new Mutation(ADD_WORD, env, openjtalk);
+    mutation->surface = surface;
+    mutation->pronunciation = pronunciation;
+    mutation->accent_type = accent_type;
+    if (word_type != nullptr) {
+        mutation->has_word_type = true;
+        mutation->word_type = *word_type;
+    }
+    if (priority != nullptr) {
+        mutation->has_priority = true;
+        mutation->priority = *priority;
+    }
+    return enqueue(env, mutation);
+}
+
+Napi::Promise UserDictWorker::rewrite_word(
+    Napi::Env env,
+    std::shared_ptr<OpenJTalk> openjtalk,
+    std::string word_uuid,
+    std::string surface,
+    std::string pronunciation,
+    int accent_type,
+    std::string *word_type,
+    int *priority
+) {
+    Mutation *mutation = new Mutation(REWRITE_WORD, env, openjtalk);
+    mutation->word_uuid = word_uuid;
+    mutation->surface = surface;
+    mutation->pronunciation = pronunciation;
+    mutation->accent_type = accent_type;
+    if (word_type != nullptr) {
+        mutation->has_word_type = true;
+        mutation->word_type = *word_type;
+    }
+    if (priority != nullptr) {
+        mutation->has_priority = true;
+        mutation->priority = *priority;
+    }
+    return enqueue(env, mutation);
+}
+
+Napi::Promise UserDictWorker::delete_word(Napi::Env env, std::shared_ptr<OpenJTalk> openjtalk, std::string word_uuid) {
+    Mutation *mutation = new Mutation(DELETE_WORD, env, openjtalk);
+    mutation->word_uuid = word_uuid;
+    return enqueue(env, mutation);
+}
+
+Napi::Promise UserDictWorker::enqueue(Napi::Env env, Mutation *mutation) {
+    Napi::Promise promise = mutation->deferred.Promise();
+    if (m_pending_count++ == 0) m_complete.Ref(env);
+    engine_metrics().add_user_dict_queue(1);
+    {
+        std::lock_guard<std::mutex> lock(m_queue_mutex);
+        m_queue.push_back(mutation);
+    }
+    m_queue_cv.notify_one();
+    return promise;
+}
+
+void UserDictWorker::run() {
+    while (true) {
+        std::vector<Mutation *> *batch = new std::vector<Mutation *>();
+        {
+            std::unique_lock<std::mutex> lock(m_queue_mutex);
+            m_queue_cv.wait(lock, [this] { return m_stopping || !m_queue.empty(); });
+            if (m_stopping) {
+                delete batch;
+                return;
+            }
+            batch->assign(m_queue.begin(), m_queue.end());
+            m_queue.clear();
+        }
+
+        apply(*batch);
+
+        // 呼び出しに失敗した場合も、デストラクタで結果を返せるようm_postedに残す
+        {
+            std::lock_guard<std::mutex> lock(m_queue_mutex);
+            m_posted.push_back(batch);
+        }
+        m_complete.NonBlockingCall(
+            batch,
+            [this](Napi::Env env, Napi::Function, std::vector<Mutation *> *batch) { complete(env, batch); }
+        );
+    }
+}
+
+void UserDictWorker::apply(std::vector<Mutation *> &batch) {
+    // 辞書ごとに、積まれた順番を保ったまままとめる
+    std::vector<OpenJTalk *> targets;
+    for (Mutation *mutation : batch) {
+        if (std::find(targets.begin(), targets.end(), mutation->openjtalk.get()) == targets.end()) {
+            targets.push_back(mutation->openjtalk.get());
+        }
+    }
+    for (OpenJTalk *openjtalk : targets) {
+        std::vector<Mutation *> mutations;
+        for (Mutation *mutation : batch) {
+            if (mutation->openjtalk.get() == openjtalk) mutations.push_back(mutation);
+        }
+        apply(openjtalk, mutations);
+    }
+}
+
+void UserDictWorker::apply(OpenJTalk *openjtalk, std::vector<Mutation *> &mutations) {
+    std::lock_guard<std::mutex> lock(openjtalk->user_dict_mutex);
+    bool changed = false;
+    json user_dict;
+    try {
+        user_dict = read_dict(openjtalk->user_dict_path);
+    } catch (std::exception& err) {
+        for (Mutation *mutation : mutations) mutation->error = err.what();
+        return;
+    }
+
+    for (Mutation *mutation : mutations) {
+        try {
+            switch (mutation->type) {
+                case ADD_WORD:
+                case REWRITE_WORD: {
+                    json word = create_word(
+                        mutation->surface,
+                        mutation->pronunciation,
+                        mutation->accent_type,
+                        mutation->has_word_type ? &mutation->word_type : nullptr,
+                        mutation->has_priority ? &mutation->priority : nullptr
+                    );
+                    if (mutation->type == ADD_WORD) mutation->word_uuid = uuid_v4();
+                    user_dict[mutation->word_uuid] = word;
+                    break;
+                }
+                case DELETE_WORD:
+                    if (!user_dict.contains(mutation->word_uuid)) {
+                        throw std::runtime_error("not found uuid");
+                    }
+                    user_dict.erase(mutation->word_uuid);
+                    break;
+            }
+            changed = true;
+        } catch (std::exception& err) {
+            mutation->error = err.what();
+        }
+    }
+    if (!changed) return;
+
+    try {
+        write_to_json(user_dict, openjtalk->user_dict_path);
+        update_dict(openjtalk);
+    } catch (std::exception& err) {
+        for (Mutation *mutation : mutations) {
+            if (mutation->error.empty()) mutation->error = err.what();
+        }
+    }
+}
+
+void UserDictWorker::complete(Napi::Env env, std::vector<Mutation *> *batch) {
+    {
+        std::lock_guard<std::mutex> lock(m_queue_mutex);
+        m_posted.erase(std::find(m_posted.begin(), m_posted.end(), batch));
+    }
+    for (Mutation *mutation : *batch) {
+        // デストラクタから呼ばれた場合は環境の終了中のことがあるので、解決に失敗しても解放は行う
+        try {
+            if (!mutation->error.empty()) {
+                mutation->deferred.Reject(Napi::Error::New(env, mutation->error).Value());
+            } else if (mutation->type == ADD_WORD) {
+                mutation->deferred.Resolve(Napi::String::New(env, mutation->word_uuid));
+            } else {
+                mutation->deferred.Resolve(env.Undefined());
+            }
+        } catch (...) {
+        }
+        delete mutation;
+    }
+    m_pending_count -= batch->size();
+    engine_metrics().add_user_dict_queue(-(int64_t)batch->size());
+    if (m_pending_count == 0) m_complete.Unref(env);
+    delete batch;
+}
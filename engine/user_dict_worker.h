@@ -0,0 +1,90 @@
+#ifndef USER_DICT_WORKER_H
+#define USER_DICT_WORKER_H
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <napi.h>
+
+#include "openjtalk.h"
+
+// ユーザー辞書の変更をバックグラウンドのスレッドで順番に処理する
+// 再構築中に積まれた変更は辞書ごとに次の一回の再構築にまとめ、Promiseは新しい辞書が読み込まれてから解決する
+class UserDictWorker {
+public:
+    UserDictWorker(Napi::Env env);
+    ~UserDictWorker();
+
+    Napi::Promise add_word(
+        Napi::Env env,
+        std::shared_ptr<OpenJTalk> openjtalk,
+        std::string surface,
+        std::string pronunciation,
+        int accent_type,
+        std::string *word_type = nullptr,
+        int *priority = nullptr
+    );
+    Napi::Promise rewrite_word(
+        Napi::Env env,
+        std::shared_ptr<OpenJTalk> openjtalk,
+        std::string word_uuid,
+        std::string surface,
+        std::string pronunciation,
+        int accent_type,
+        std::string *word_type = nullptr,
+        int *priority = nullptr
+    );
+    Napi::Promise delete_word(Napi::Env env, std::shared_ptr<OpenJTalk> openjtalk, std::string word_uuid);
+
+private:
+    enum MutationType {
+        ADD_WORD,
+        REWRITE_WORD,
+        DELETE_WORD,
+    };
+
+    struct Mutation {
+        MutationType type;
+        // 辞書の名前空間が処理中に削除されても、処理が終わるまでは保持する
+        std::shared_ptr<OpenJTalk> openjtalk;
+        std::string word_uuid;
+        std::string surface;
+        std::string pronunciation;
+        int accent_type = 0;
+        bool has_word_type = false;
+        std::string word_type;
+        bool has_priority = false;
+        int priority = 0;
+        Napi::Promise::Deferred deferred;
+        std::string error;
+
+        Mutation(MutationType type, Napi::Env env, std::shared_ptr<OpenJTalk> openjtalk)
+            : type(type), openjtalk(openjtalk), deferred(Napi::Promise::Deferred::New(env)) {}
+    };
+
+    Napi::Env m_env;
+    Napi::ThreadSafeFunction m_complete;
+    // JSスレッドからのみ触る、結果待ちの変更の数
+    size_t m_pending_count = 0;
+
+    std::mutex m_queue_mutex;
+    std::condition_variable m_queue_cv;
+    std::deque<Mutation *> m_queue;
+    // 処理を終え、JSスレッドで結果を返すのを待っているまとまり
+    std::vector<std::vector<Mutation *> *> m_posted;
+    bool m_stopping = false;
+    std::thread m_thread;
+
+    Napi::Promise enqueue(Napi::Env env, Mutation *mutation);
+    void run();
+    void apply(std::vector<Mutation *> &batch);
+    void apply(OpenJTalk *openjtalk, std::vector<Mutation *> &mutations);
+    void complete(Napi::Env env, std::vector<Mutation *> *batch);
+};
+
+#endif // USER_DICT_WORKER_H
@@ -0,0 +1,190 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+
+#include "wave_resampler.h"
+
+constexpr double PI = 3.14159265358979323846;
+// 阻止域の減衰量と計算量の兼ね合いで決めた値
+constexpr int BASE_HALF_TAPS = 16;
+constexpr double KAISER_BETA = 8.0;
+// 変換後のナイキスト周波数の手前で落とし切るための余裕
+constexpr double CUTOFF_MARGIN = 0.95;
+// 位相の数がこれを超える周波数比では、最も近い位相の係数で代用する
+constexpr int64_t MAX_PHASES = 1024;
+
+static int64_t gcd(int64_t a, int64_t b) {
+    while (b != 0) {
+        int64_t t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+// 第1種変形ベッセル関数(0次)
+static double bessel_i0(double x) {
+    double sum = 1.0;
+    double term = 1.0;
+    for (int k = 1; k < 32; k++) {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+        if (term < sum * 1e-12) break;
+    }
+    return sum;
+}
+
+static std::shared_ptr<const ResampleFilter> create_resample_filter(int input_rate, int output_rate) {
+    int64_t divisor = gcd(input_rate, output_rate);
+    std::shared_ptr<ResampleFilter> filter = std::make_shared<ResampleFilter>();
+    filter->input_step = input_rate / divisor;
+    filter->output_step = output_rate / divisor;
+
+    // ダウンサンプリングでは変換後のナイキスト周波数に合わせて帯域を絞り、その分フィルタを長くする
+    double ratio = std::min(1.0, (double)filter->output_step / (double)filter->input_step);
+    double cutoff = ratio * CUTOFF_MARGIN;
+    filter->half_taps = (int)std::ceil(BASE_HALF_TAPS / ratio);
+    filter->taps = (filter->half_taps * 2 + 3) / 4 * 4;
+    filter->phases = (int)std::min(filter->output_step, MAX_PHASES);
+    filter->coefficients.assign((size_t)filter->phases * filter->taps, 0.0f);
+
+    double i0_beta = bessel_i0(KAISER_BETA);
+    for (int phase = 0; phase < filter->phases; phase++) {
+        float *row = filter->coefficients.data() + (size_t)phase * filter->taps;
+        double frac = (double)phase / (double)filter->phases;
+        double sum = 0.0;
+        std::vector<double> values(filter->half_taps * 2);
+        for (int j = 0; j < filter->half_taps * 2; j++) {
+            // 出力位置から見た入力サンプルの位置
+            double distance = (double)(j - filter->half_taps + 1) - frac;
+            double x = cutoff * distance;
+            double sinc = x == 0.0 ? 1.0 : std::sin(PI * x) / (PI * x);
+            double position = distance / (double)filter->half_taps;
+            double window = std::abs(position) >= 1.0
+                ? 0.0
+                : bessel_i0(KAISER_BETA * std::sqrt(1.0 - position * position)) / i0_beta;
+            values[j] = cutoff * sinc * window;
+            sum += values[j];
+        }
+        // 直流成分の利得を位相によらず1にする
+        for (int j = 0; j < filter->half_taps * 2; j++) {
+            row[j] = (float)(values[j] / sum);
+        }
+    }
+    return filter;
+}
+
+std::shared_ptr<const ResampleFilter> get_resample_filter(int input_rate, int output_rate) {
+    if (input_rate <= 0 || output_rate <= 0) {
+        throw std::runtime_error("sampling rate must be positive");
+    }
+
+    static std::mutex filters_mutex;
+    static std::map<std::pair<int, int>, std::shared_ptr<const ResampleFilter>> filters;
+
+    std::lock_guard<std::mutex> lock(filters_mutex);
+    std::pair<int, int> key(input_rate, output_rate);
+    auto found = filters.find(key);
+    if (found != filters.end()) return found->second;
+
+    std::shared_ptr<const ResampleFilter> filter = create_resample_filter(input_rate, output_rate);
+    filters[key] = filter;
+    return filter;
+}
+
+// 4つの部分和に分けて、コンパイラがSIMD命令にまとめられるようにする
+static inline float dot_product(const float *x, const float *y, int size) {
+    float sum0 = 0.0f, sum1 = 0.0f, sum2 = 0.0f, sum3 = 0.0f;
+    for (int i = 0; i < size; i += 4) {
+        sum0 += x[i] * y[i];
+        sum1 += x[i + 1] * y[i + 1];
+        sum2 += x[i + 2] * y[i + 2];
+        sum3 += x[i + 3] * y[i + 3];
+    }
+    return (sum0 + sum1) + (sum2 + sum3);
+}
+
+WaveResampler::WaveResampler(int input_rate, int output_rate) {
+    m_input_rate = input_rate;
+    m_output_rate = output_rate;
+    m_filter = get_resample_filter(input_rate, output_rate);
+    reset();
+}
+
+void WaveResampler::reset() {
+    // 先頭より前は無音として扱う
+    m_buffer_start = -(m_filter->half_taps - 1);
+    m_buffer.assign(m_filter->half_taps - 1, 0.0f);
+    m_input_count = 0;
+    m_output_count = 0;
+}
+
+void WaveResampler::process(const float *input, size_t input_size, std::vector<float> &output) {
+    if (m_input_rate == m_output_rate) {
+        output.insert(output.end(), input, input + input_size);
+        return;
+    }
+
+    m_buffer.insert(m_buffer.end(), input, input + input_size);
+    m_input_count += input_size;
+    produce(std::numeric_limits<int64_t>::max(), output);
+}
+
+void WaveResampler::flush(std::vector<float> &output) {
+    if (m_input_rate != m_output_rate) {
+        const ResampleFilter &filter = *m_filter;
+        // 終端より後ろは無音として扱う
+        m_buffer.insert(m_buffer.end(), filter.taps, 0.0f);
+        int64_t output_size = (m_input_count * filter.output_step + filter.input_step - 1) / filter.input_step;
+        produce(output_size, output);
+    }
+    reset();
+}
+
+void WaveResampler::produce(int64_t output_limit, std::vector<float> &output) {
+    const ResampleFilter &filter = *m_filter;
+    int64_t buffer_end = m_buffer_start + (int64_t)m_buffer.size();
+
+    while (m_output_count < output_limit) {
+        // 出力サンプルに対応する入力の位置(整数部と余り)
+        int64_t position = m_output_count * filter.input_step;
+        int64_t index = position / filter.output_step;
+        int64_t remainder = position % filter.output_step;
+
+        int64_t first = index - filter.half_taps + 1;
+        if (first + filter.taps > buffer_end) break;
+
+        int64_t phase = filter.phases == filter.output_step
+            ? remainder
+            : remainder * filter.phases / filter.output_step;
+        output.push_back(dot_product(
+            m_buffer.data() + (first - m_buffer_start),
+            filter.coefficients.data() + phase * filter.taps,
+            filter.taps
+        ));
+        m_output_count++;
+    }
+
+    // 次の出力で使わない入力を捨てる
+    int64_t next_first = m_output_count * filter.input_step / filter.output_step - filter.half_taps + 1;
+    int64_t discard = std::min(next_first - m_buffer_start, (int64_t)m_buffer.size());
+    if (discard > 0) {
+        m_buffer.erase(m_buffer.begin(), m_buffer.begin() + discard);
+        m_buffer_start += discard;
+    }
+}
+
+std::vector<float> WaveResampler::resample(const std::vector<float> &input, int input_rate, int output_rate) {
+    if (input_rate == output_rate) return input;
+
+    WaveResampler resampler(input_rate, output_rate);
+    std::vector<float> output;
+    output.reserve((size_t)((double)input.size() * output_rate / input_rate) + 1);
+    resampler.process(input.data(), input.size(), output);
+    resampler.flush(output);
+    return output;
+}
@@ -0,0 +1,53 @@
+#ifndef WAVE_RESAMPLER_H
+#define WAVE_RESAMPLER_H
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// 周波数比ごとに事前計算したポリフェーズフィルタ(Kaiser窓付きsinc)
+struct ResampleFilter {
+    // 入力input_step個に対して出力output_step個を生成する(既約分数)
+    int64_t input_step;
+    int64_t output_step;
+    // フィルタの片側の長さ(入力サンプル数)
+    int half_taps;
+    // 1位相あたりの係数の数(4の倍数に揃えてある)
+    int taps;
+    int phases;
+    // phases * taps個の係数。位相ごとに連続して並ぶ
+    std::vector<float> coefficients;
+};
+
+// 同じ周波数比のフィルタは一度だけ計算し、以降は共有する
+std::shared_ptr<const ResampleFilter> get_resample_filter(int input_rate, int output_rate);
+
+// 任意の周波数間で波形を変換する
+// process()を分割して呼び出すと、前回までの入力を保持したまま続きを変換する
+class WaveResampler {
+public:
+    WaveResampler(int input_rate, int output_rate);
+
+    // 入力を追加し、確定した分の出力をoutputの末尾に追加する
+    void process(const float *input, size_t input_size, std::vector<float> &output);
+    // 入力の終端までの残りの出力をoutputの末尾に追加する
+    void flush(std::vector<float> &output);
+    void reset();
+
+    // 一度に全体を変換する
+    static std::vector<float> resample(const std::vector<float> &input, int input_rate, int output_rate);
+
+private:
+    int m_input_rate;
+    int m_output_rate;
+    std::shared_ptr<const ResampleFilter> m_filter;
+    // m_buffer[0]が入力の何サンプル目にあたるか(先頭の無音の分だけ負になる)
+    int64_t m_buffer_start;
+    std::vector<float> m_buffer;
+    int64_t m_input_count;
+    int64_t m_output_count;
+
+    void produce(int64_t output_limit, std::vector<float> &output);
+};
+
+#endif // WAVE_RESAMPLER_H
@@ -0,0 +1,195 @@
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include "flac_encoder.h"
+#include "g711.h"
+#include "pcm_kernel.h"
+#include "wave_writer.h"
+
+struct WaveFormatInfo {
+    WaveFormat format;
+    const char *name;
+    bool has_header;
+    int bit_depth;
+    bool is_float;
+};
+
+static const WaveFormatInfo wave_format_info[] = {
+    { WAVE_FORMAT_WAV_INT16, "wav", true, 16, false },
+    { WAVE_FORMAT_WAV_INT24, "wav_int24", true, 24, false },
+    { WAVE_FORMAT_WAV_FLOAT32, "wav_float32", true, 32, true },
+    { WAVE_FORMAT_RAW_INT16, "raw_int16", false, 16, false },
+    { WAVE_FORMAT_RAW_INT24, "raw_int24", false, 24, false },
+    { WAVE_FORMAT_RAW_FLOAT32, "raw_float32", false, 32, true },
+    // FLACのヘッダはFlacEncoderが書き込む
+    { WAVE_FORMAT_FLAC, "flac", false, 16, false },
+    { WAVE_FORMAT_MULAW, "mulaw", false, 8, false },
+    { WAVE_FORMAT_ALAW, "alaw", false, 8, false },
+};
+
+// リニアPCMは44byte、浮動小数点はfmtチャンクの拡張部分とfactチャンクが付いて58byte
+constexpr size_t PCM_HEADER_SIZE = 44;
+constexpr size_t FLOAT_HEADER_SIZE = 58;
+
+static const WaveFormatInfo &find_wave_format_info(WaveFormat format) {
+    for (const WaveFormatInfo &info : wave_format_info) {
+        if (info.format == format) return info;
+    }
+    return wave_format_info[0];
+}
+
+bool parse_wave_format(const std::string &name, WaveFormat &format) {
+    for (const WaveFormatInfo &info : wave_format_info) {
+        if (name == info.name) {
+            format = info.format;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char *wave_format_name(WaveFormat format) {
+    return find_wave_format_info(format).name;
+}
+
+bool is_g711_format(WaveFormat format) {
+    return format == WAVE_FORMAT_MULAW || format == WAVE_FORMAT_ALAW;
+}
+
+static void write_le(char *dst, uint32_t value, int bytes) {
+    for (int i = 0; i < bytes; i++) {
+        dst[i] = (char)(value & 0xff);
+        value >>= 8;
+    }
+}
+
+WaveWriter::WaveWriter(WaveFormat format, int num_channels, int sampling_rate) {
+    m_format = format;
+    m_num_channels = num_channels;
+    m_sampling_rate = sampling_rate;
+    m_leading_silence = 0;
+    m_trailing_silence = 0;
+}
+
+void WaveWriter::set_silence(size_t leading, size_t trailing) {
+    m_leading_silence = leading;
+    m_trailing_silence = trailing;
+}
+
+int WaveWriter::bytes_per_sample() const {
+    return find_wave_format_info(m_format).bit_depth / 8;
+}
+
+size_t WaveWriter::header_size() const {
+    const WaveFormatInfo &info = find_wave_format_info(m_format);
+    if (!info.has_header) return 0;
+    return info.is_float ? FLOAT_HEADER_SIZE : PCM_HEADER_SIZE;
+}
+
+bool WaveWriter::has_fixed_size() const {
+    return m_format != WAVE_FORMAT_FLAC && !is_g711_format(m_format);
+}
+
+size_t WaveWriter::output_size(size_t size) const {
+    size += m_leading_silence + m_trailing_silence;
+    return header_size() + size * m_num_channels * bytes_per_sample();
+}
+
+void WaveWriter::write_header(char *dst, size_t bytes_size) const {
+    const WaveFormatInfo &info = find_wave_format_info(m_format);
+    int block_size = info.bit_depth * m_num_channels / 8;
+    size_t header_length = header_size();
+
+    std::memcpy(dst, "RIFF", 4);
+    write_le(dst + 4, (uint32_t)(bytes_size + header_length - 8), 4); // chunk size
+    std::memcpy(dst + 8, "WAVEfmt ", 8);
+    write_le(dst + 16, info.is_float ? 18 : 16, 4); // fmt header length
+    write_le(dst + 20, info.is_float ? 3 : 1, 2); // IEEE float / linear PCM
+    write_le(dst + 22, m_num_channels, 2);
+    write_le(dst + 24, m_sampling_rate, 4);
+    write_le(dst + 28, m_sampling_rate * block_size, 4); // block rate
+    write_le(dst + 32, block_size, 2);
+    write_le(dst + 34, info.bit_depth, 2);
+
+    char *data_chunk = dst + 36;
+    if (info.is_float) {
+        write_le(dst + 36, 0, 2); // 拡張部分の長さ
+        std::memcpy(dst + 38, "fact", 4);
+        write_le(dst + 42, 4, 4);
+        write_le(dst + 46, (uint32_t)(bytes_size / block_size), 4); // 1チャンネルあたりのサンプル数
+        data_chunk = dst + 50;
+    }
+    std::memcpy(data_chunk, "data", 4);
+    write_le(data_chunk + 4, (uint32_t)bytes_size, 4);
+}
+
+void WaveWriter::write(const float *wave, size_t size, float gain, char *dst) const {
+    size_t header_length = header_size();
+    size_t frame_bytes = m_num_channels * bytes_per_sample();
+    if (header_length > 0) {
+        write_header(dst, (m_leading_silence + size + m_trailing_silence) * frame_bytes);
+    }
+
+    // 整数と浮動小数点のどちらの形式でも、無音は全てのbitが0になる
+    char *data = dst + header_length;
+    std::memset(data, 0, m_leading_silence * frame_bytes);
+    data += m_leading_silence * frame_bytes;
+    std::memset(data + size * frame_bytes, 0, m_trailing_silence * frame_bytes);
+    switch (m_format) {
+    case WAVE_FORMAT_WAV_INT16:
+    case WAVE_FORMAT_RAW_INT16:
+        convert_to_int16(wave, size, gain, m_num_channels, (int16_t *)data);
+        break;
+    case WAVE_FORMAT_WAV_INT24:
+    case WAVE_FORMAT_RAW_INT24:
+        convert_to_int24(wave, size, gain, m_num_channels, (uint8_t *)data);
+        break;
+    case WAVE_FORMAT_WAV_FLOAT32:
+    case WAVE_FORMAT_RAW_FLOAT32:
+        convert_to_float32(wave, size, gain, m_num_channels, (uint8_t *)data);
+        break;
+    case WAVE_FORMAT_FLAC:
+    case WAVE_FORMAT_MULAW:
+    case WAVE_FORMAT_ALAW:
+        throw std::runtime_error(std::string(wave_format_name(m_format)) + " cannot be written to a fixed size buffer");
+    }
+}
+
+std::vector<char> WaveWriter::write(const std::vector<float> &wave, float gain) const {
+    size_t total = m_leading_silence + wave.size() + m_trailing_silence;
+    if (m_format == WAVE_FORMAT_FLAC) {
+        std::vector<int16_t> pcm(wave.size() * m_num_channels);
+        convert_to_int16(wave.data(), wave.size(), gain, m_num_channels, pcm.data());
+        // 無音の部分は定数のサブフレームとしてほとんど符号量を使わない
+        std::vector<int32_t> samples(total * m_num_channels, 0);
+        std::copy(pcm.begin(), pcm.end(), samples.begin() + m_leading_silence * m_num_channels);
+
+        FlacEncoder encoder(m_num_channels, m_sampling_rate);
+        std::vector<uint8_t> encoded;
+        encoder.header(total, encoded);
+        encoder.encode(samples.data(), total, encoded);
+        encoder.finish(encoded);
+        return std::vector<char>(encoded.begin(), encoded.end());
+    }
+
+    if (is_g711_format(m_format)) {
+        // 8kHzへの変換をまたいで無音を繋げるため、圧伸の前に波形へ足す
+        std::vector<float> padded(total, 0.0f);
+        std::copy(wave.begin(), wave.end(), padded.begin() + m_leading_silence);
+        std::vector<uint8_t> encoded;
+        encode_g711(
+            padded.data(),
+            padded.size(),
+            m_sampling_rate,
+            gain,
+            m_format == WAVE_FORMAT_MULAW ? G711_MULAW : G711_ALAW,
+            encoded
+        );
+        return std::vector<char>(encoded.begin(), encoded.end());
+    }
+
+    std::vector<char> output(output_size(wave.size()));
+    write(wave.data(), wave.size(), gain, output.data());
+    return output;
+}
@@ -0,0 +1,56 @@
+#ifndef WAVE_WRITER_H
+#define WAVE_WRITER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+enum WaveFormat {
+    WAVE_FORMAT_WAV_INT16,
+    WAVE_FORMAT_WAV_INT24,
+    WAVE_FORMAT_WAV_FLOAT32,
+    WAVE_FORMAT_RAW_INT16,
+    WAVE_FORMAT_RAW_INT24,
+    WAVE_FORMAT_RAW_FLOAT32,
+    WAVE_FORMAT_FLAC,
+    WAVE_FORMAT_MULAW,
+    WAVE_FORMAT_ALAW,
+};
+
+// "wav"や"raw_float32"などの名前から形式を得る。該当しない場合はfalseを返す
+bool parse_wave_format(const std::string &name, WaveFormat &format);
+const char *wave_format_name(WaveFormat format);
+// G.711は常に8kHzのモノラルで出力する
+bool is_g711_format(WaveFormat format);
+
+// 形式ごとに、ヘッダと波形を出力先へ直接書き込む
+class WaveWriter {
+public:
+    // sampling_rateは書き込む波形の周波数。G.711ではそこから8kHzに変換し、num_channelsは無視する
+    WaveWriter(WaveFormat format, int num_channels, int sampling_rate);
+
+    // 波形の前後に書き込む無音のサンプル数。output_size()とwrite()の両方に含まれる
+    void set_silence(size_t leading, size_t trailing);
+    // 圧縮する形式では、書き込む前に出力のbyte数が決まらない
+    bool has_fixed_size() const;
+    // size個のサンプルを書き込むのに必要なbyte数(has_fixed_size()がtrueの形式のみ)
+    size_t output_size(size_t size) const;
+    // dstにはoutput_size(size)byte分の領域が必要(has_fixed_size()がtrueの形式のみ)
+    void write(const float *wave, size_t size, float gain, char *dst) const;
+    // 全ての形式で使える
+    std::vector<char> write(const std::vector<float> &wave, float gain) const;
+
+private:
+    WaveFormat m_format;
+    int m_num_channels;
+    int m_sampling_rate;
+    size_t m_leading_silence;
+    size_t m_trailing_silence;
+
+    int bytes_per_sample() const;
+    size_t header_size() const;
+    void write_header(char *dst, size_t bytes_size) const;
+};
+
+#endif // WAVE_WRITER_H
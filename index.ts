@@ -49,6 +49,120 @@ export interface UserDictWord {
   accent_associative_rule: string
 }
 
+/**
+ * 音声合成の出力形式
+ * wav: 16bit整数のWAV
+ * wav_int24: 24bit整数のWAV
+ * wav_float32: 32bit浮動小数点のWAV
+ * raw_int16/raw_int24/raw_float32: ヘッダなしのリトルエンディアンのPCM（ステレオの場合はインターリーブ）
+ * flac: 16bitの可逆圧縮（FLAC）
+ * mulaw/alaw: 8kHzモノラルのG.711（ヘッダなし、RTPのペイロードにそのまま使える）
+ */
+export type OutputFormat =
+  | 'wav'
+  | 'wav_int24'
+  | 'wav_float32'
+  | 'raw_int16'
+  | 'raw_int24'
+  | 'raw_float32'
+  | 'flac'
+  | 'mulaw'
+  | 'alaw'
+
+export interface SynthesisOptions {
+  format?: OutputFormat
+  /**
+   * trueの場合、prePhonemeLengthとpostPhonemeLengthのうち0.1秒を超える部分は
+   * 音声合成せず、無音のサンプルとして直接書き込みます。
+   */
+  directSilence?: boolean
+  /** trueの場合、前後の無音を切り詰めます。 */
+  trimSilence?: boolean
+  /** 切り詰める無音の閾値(dBFS)、省略すると-50 */
+  trimThreshold?: number
+  /**
+   * 指定したラウドネス(LUFS)に揃えます。ピークが0dBFSを超えない範囲で音量を調整し、
+   * volumeScaleはその後にかかります。0.4秒より短い音声は全体の平均で測ります。
+   */
+  normalizeLoudness?: number
+}
+
+/**
+ * synthesis_with_timingの結果
+ * 位置は音声のサンプル数(チャンネルあたり)で、開始と終了を交互に並べています。
+ */
+export interface SynthesisTimingResult {
+  wave: Buffer
+  /** 位置の基準になるサンプリングレート(mulaw、alawでは8000) */
+  sampling_rate: number
+  /** 前後の無音(pau)を含む音素の列 */
+  phonemes: string[]
+  phoneme_timings: Uint32Array
+  /** アクセント句ごとのmorasとpause_moraを順に並べたモーラの位置 */
+  mora_timings: Uint32Array
+  /** この合成の、処理の段階ごとにかかった時間(ミリ秒)。段階の名前はEngineStatsのstagesと同じ */
+  stage_timings: Record<string, number>
+}
+
+/**
+ * 処理の段階ごとにかかった時間の集計
+ */
+export interface StageStats {
+  count: number
+  total_ms: number
+  max_ms: number
+  /** 2のべき乗のバケットの上端で近似した値 */
+  p50_ms: number
+  p95_ms: number
+  p99_ms: number
+  /** i番目は2^(i-1)マイクロ秒以上2^iマイクロ秒未満の件数(0番目は1マイクロ秒未満) */
+  buckets: number[]
+  memory: MemoryStats
+}
+
+/**
+ * 確保したメモリの集計。memory_accountingを有効にしてビルドした場合のみ記録される
+ */
+export interface MemoryStats {
+  count: number
+  /** 確保したbyte数の合計 */
+  allocated_bytes: number
+  /** 1回の処理の中で、確保したままのbyte数が最も増えたときの値 */
+  peak_bytes: number
+}
+
+/**
+ * リクエストの種類ごとの集計
+ */
+export interface RequestStats {
+  memory: MemoryStats
+}
+
+export interface EngineStats {
+  /**
+   * 段階の名前はtext2mecab, mecab, njd, label, yukarin_s, yukarin_sa,
+   * frames, decode, resample, trim, normalize, encode
+   */
+  stages: Record<string, StageStats>
+  /**
+   * 種類の名前はaudio_query, accent_phrases, mora_data, mora_length, mora_pitch,
+   * synthesis, synthesis_with_timing, synthesis_concat
+   */
+  requests: Record<string, RequestStats>
+  /** node-gyp rebuild --memory_accounting=true でビルドした場合はtrue */
+  memory_accounting: boolean
+}
+
+/**
+ * synthesis_concatで繋げる区間
+ */
+export interface SynthesisSegment {
+  audio_query: AudioQuery
+  speaker_id: number
+  /** 次の区間との間に入れる無音の長さ(秒) */
+  silence_after?: number
+}
+
 export type WordTypes =
   | 'PROPER_NOUN'
   | 'COMMON_NOUN'
@@ -57,11 +171,16 @@ export type WordTypes =
   | 'SUFFIX'
 
 interface IEngine {
-  audio_query(text: string, speaker_id: number): AudioQuery
+  audio_query(
+    text: string,
+    speaker_id: number,
+    dict_namespace?: string
+  ): AudioQuery
   accent_phrases(
     text: string,
     speaker_id: number,
-    is_kana?: boolean
+    is_kana?: boolean,
+    dict_namespace?: string
   ): AccentPhrase[]
   mora_data(accent_phrases: AccentPhrase[], speaker_id: number): AccentPhrase[]
   mora_length(
@@ -72,8 +191,27 @@ interface IEngine {
   synthesis(
     audio_query: AudioQuery,
     speaker_id: number,
-    enable_interrogative_upspeak?: boolean
+    enable_interrogative_upspeak?: boolean,
+    options?: SynthesisOptions
+  ): Buffer
+  synthesis_with_timing(
+    audio_query: AudioQuery,
+    speaker_id: number,
+    enable_interrogative_upspeak: boolean,
+    options?: SynthesisOptions
+  ): SynthesisTimingResult
+  synthesis_concat(
+    segments: SynthesisSegment[],
+    enable_interrogative_upspeak: boolean,
+    options?: SynthesisOptions
   ): Buffer
+  calibrate_pre_padding(speaker_id: number): number
+  stats(reset?: boolean): EngineStats
+  metrics(): string
+  start_trace(): void
+  stop_trace(): void
+  dump_trace(): string
+  startup_timings(): Record<string, number>
   metas(): string
   yukarin_s_forward(phoneme_list: number[], speaker_id: number): number[]
   yukarin_sa_forward(
@@ -90,13 +228,14 @@ interface IEngine {
     phoneme: number[][],
     speaker_id: number
   ): number[]
-  get_user_dict_words(): Record<string, UserDictWord>
+  get_user_dict_words(dict_namespace?: string): Record<string, UserDictWord>
   add_user_dict_word(
     surface: string,
     pronunciation: string,
     accent_type: number,
     word_type?: WordTypes,
-    priority?: number
+    priority?: number,
+    dict_namespace?: string
   ): string
   rewrite_user_dict_word(
     surface: string,
@@ -104,9 +243,53 @@ interface IEngine {
     accent_type: number,
     word_uuid: string,
     word_type?: WordTypes,
-    priority?: number
+    priority?: number,
+    dict_namespace?: string
   ): void
-  delete_user_dict_word(word_uuid: string): void
+  delete_user_dict_word(word_uuid: string, dict_namespace?: string): void
+  add_user_dict_word_async(
+    surface: string,
+    pronunciation: string,
+    accent_type: number,
+    word_type?: WordTypes,
+    priority?: number,
+    dict_namespace?: string
+  ): Promise<string>
+  rewrite_user_dict_word_async(
+    surface: string,
+    pronunciation: string,
+    accent_type: number,
+    word_uuid: string,
+    word_type?: WordTypes,
+    priority?: number,
+    dict_namespace?: string
+  ): Promise<void>
+  delete_user_dict_word_async(
+    word_uuid: string,
+    dict_namespace?: string
+  ): Promise<void>
+  create_dict_namespace(name: string): void
+  create_dict_namespace_async(name: string): Promise<void>
+  delete_dict_namespace(name: string): void
+  dict_namespaces(): string[]
+}
+
+// addonのコンストラクタとcreate_asyncに渡す引数
+function addonArguments(
+  coreFilePath: string,
+  useGpu: boolean
+): [string, string, string, string, boolean] {
+  const user_dict_root = __dirname + '/user_dict/'
+  if (!fs.existsSync(user_dict_root)) {
+    fs.mkdirSync(user_dict_root)
+  }
+  return [
+    __dirname + '/open_jtalk_dic_utf_8-1.11/',
+    __dirname + '/default.csv',
+    user_dict_root,
+    coreFilePath,
+    useGpu,
+  ]
 }
 
 /**
@@ -125,18 +308,34 @@ class Engine implements IEngine {
    * @param {boolean} useGpu - GPUを使うか否か
    */
   constructor(coreFilePath: string, useGpu: boolean) {
-    const user_dict_root = __dirname + '/user_dict/'
-    if (!fs.existsSync(user_dict_root)) {
-      fs.mkdirSync(user_dict_root)
-  }
+    const args = addonArguments(coreFilePath, useGpu)
     // eslint-disable-next-line @typescript-eslint/no-unsafe-assignment, @typescript-eslint/no-unsafe-call
-    this.addon = new addon(
-      __dirname + '/open_jtalk_dic_utf_8-1.11/',
-      __dirname + '/default.csv',
-      user_dict_root,
-      coreFilePath,
-      useGpu
-    )
+    this.addon = new addon(args[0], args[1], args[2], args[3], args[4])
+  }
+
+  /**
+   * Engineクラスを非同期に初期化します。
+   * Coreライブラリとモデルの読み込み、辞書の準備を別のスレッドで行うため、その間もイベントループを止めません。
+   * 読み込みに失敗した場合、Promiseはエラーでrejectされます。
+   * @param {string} coreFilePath - Coreライブラリのパス(絶対パス推奨)
+   * @param {boolean} useGpu - GPUを使うか否か
+   * @return {Promise<Engine>} - 初期化したEngine
+   */
+  static create(coreFilePath: string, useGpu: boolean): Promise<Engine> {
+    const args = addonArguments(coreFilePath, useGpu)
+    // eslint-disable-next-line @typescript-eslint/no-unsafe-call, @typescript-eslint/no-unsafe-member-access
+    const loading = addon.create_async(
+      args[0],
+      args[1],
+      args[2],
+      args[3],
+      args[4]
+    ) as Promise<IEngine>
+    return loading.then((instance) => {
+      const engine = Object.create(Engine.prototype) as { addon: IEngine }
+      engine.addon = instance
+      return engine as unknown as Engine
+    })
   }
 
   /**
@@ -145,10 +344,15 @@ class Engine implements IEngine {
    * ここで得られたクエリはそのまま音声合成に利用できます。
    * @param {string} text - 音声合成用の文字列
    * @param {number} speaker_id - 話者ID
+   * @param {string} dict_namespace - 使用するユーザー辞書の名前空間、省略すると既定の辞書を使う
    * @return {AudioQuery} - 音声合成用のクエリ
    */
-  audio_query(text: string, speaker_id: number): AudioQuery {
-    return this.addon.audio_query(text, speaker_id)
+  audio_query(
+    text: string,
+    speaker_id: number,
+    dict_namespace?: string
+  ): AudioQuery {
+    return this.addon.audio_query(text, speaker_id, dict_namespace)
   }
 
   /**
@@ -156,14 +360,21 @@ class Engine implements IEngine {
    * @param {string} text - アクセント句を取得したい文字列
    * @param {number} speaker_id - 話者ID
    * @param {boolean} is_kana - AquesTalkライクな記法の文字列かどうか
+   * @param {string} dict_namespace - 使用するユーザー辞書の名前空間、省略すると既定の辞書を使う
    * @return {AccentPhrase[]} - アクセント句
    */
   accent_phrases(
     text: string,
     speaker_id: number,
-    is_kana?: boolean
+    is_kana?: boolean,
+    dict_namespace?: string
   ): AccentPhrase[] {
-    return this.addon.accent_phrases(text, speaker_id, is_kana ?? false)
+    return this.addon.accent_phrases(
+      text,
+      speaker_id,
+      is_kana ?? false,
+      dict_namespace
+    )
   }
 
   /**
@@ -210,20 +421,131 @@ class Engine implements IEngine {
    * @param {AudioQuery} audio_query - 音声合成用のクエリ
    * @param {number} speaker_id - 話者ID
    * @param {boolean} enable_interrogative_upspeak - 疑問文対応
-   * @return {Buffer} - 音声合成されたwav形式のバイナリ
+   * @param {SynthesisOptions} options - 出力形式などの設定、省略すると16bitのwav形式
+   * @return {Buffer} - 音声合成されたバイナリ
    */
   synthesis(
     audio_query: AudioQuery,
     speaker_id: number,
-    enable_interrogative_upspeak?: boolean
+    enable_interrogative_upspeak?: boolean,
+    options?: SynthesisOptions
   ): Buffer {
     return this.addon.synthesis(
       audio_query,
       speaker_id,
-      enable_interrogative_upspeak ?? true
+      enable_interrogative_upspeak ?? true,
+      options
+    )
+  }
+
+  /**
+   * 音声合成し、音声と一緒に音素とモーラごとの開始と終了の位置を返します。
+   * @param {AudioQuery} audio_query - 音声合成用のクエリ
+   * @param {number} speaker_id - 話者ID
+   * @param {boolean} enable_interrogative_upspeak - 疑問文対応
+   * @param {SynthesisOptions} options - 出力形式などの設定、省略すると16bitのwav形式
+   * @return {SynthesisTimingResult} - 音声合成されたバイナリと、音素とモーラの位置
+   */
+  synthesis_with_timing(
+    audio_query: AudioQuery,
+    speaker_id: number,
+    enable_interrogative_upspeak?: boolean,
+    options?: SynthesisOptions
+  ): SynthesisTimingResult {
+    return this.addon.synthesis_with_timing(
+      audio_query,
+      speaker_id,
+      enable_interrogative_upspeak ?? true,
+      options
+    )
+  }
+
+  /**
+   * 複数のAudioQueryを並列に音声合成し、1つの音声として繋げます。
+   * コアライブラリの呼び出しは1つずつ行い、リサンプリングや後処理を並列に行います。
+   * サンプリングレートとステレオかどうかは最初のAudioQueryに合わせます。
+   * @param {SynthesisSegment[]} segments - 繋げる区間と話者ID
+   * @param {boolean} enable_interrogative_upspeak - 疑問文対応
+   * @param {SynthesisOptions} options - 出力形式などの設定、省略すると16bitのwav形式
+   * @return {Buffer} - 音声合成されたバイナリ
+   */
+  synthesis_concat(
+    segments: SynthesisSegment[],
+    enable_interrogative_upspeak?: boolean,
+    options?: SynthesisOptions
+  ): Buffer {
+    return this.addon.synthesis_concat(
+      segments,
+      enable_interrogative_upspeak ?? true,
+      options
     )
   }
 
+  /**
+   * 話者ごとに、合成時に先頭へ足して捨てる無音(既定では0.4秒)の長さを校正します。
+   * 以降のsynthesisでは校正した長さを使うため、短い文ほど復号の計算量が減ります。
+   * @param {number} speaker_id - 話者ID
+   * @return {number} - 校正した余白の長さ(秒)
+   */
+  calibrate_pre_padding(speaker_id: number): number {
+    return this.addon.calibrate_pre_padding(speaker_id)
+  }
+
+  /**
+   * 処理の段階ごとにかかった時間と、段階・リクエストの種類ごとに確保したメモリの集計を取得します。
+   * 集計はプロセス全体で共有され、全てのインスタンスの処理を含みます。
+   * @param {boolean} reset - trueの場合、取得した後に集計を0に戻す
+   * @return {EngineStats} - 段階ごと、リクエストの種類ごとの集計
+   */
+  stats(reset?: boolean): EngineStats {
+    return this.addon.stats(reset ?? false)
+  }
+
+  /**
+   * リクエストの数と失敗の数、処理中のリクエスト、段階ごとの時間のヒストグラム、
+   * コアライブラリの失敗の数、ユーザー辞書の再構築の時間と待っている変更の数、合成した音声の長さを、
+   * Prometheusのテキスト形式で取得します。
+   * 値はプロセス全体で共有され、stats(true)で0に戻した段階ごとの時間以外は0に戻りません。
+   * @return {string} - Prometheusのテキスト形式
+   */
+  metrics(): string {
+    return this.addon.metrics()
+  }
+
+  /**
+   * 処理の区間の記録を始めます。記録はプロセス全体で共有され、全てのインスタンスの処理を含みます。
+   */
+  start_trace(): void {
+    this.addon.start_trace()
+  }
+
+  /**
+   * 処理の区間の記録を止めます。記録済みの区間はdump_traceで取得できます。
+   */
+  stop_trace(): void {
+    this.addon.stop_trace()
+  }
+
+  /**
+   * 記録した区間をChromeのtrace event形式のJSONで取得し、記録を空にします。
+   * chrome://tracingやPerfettoで開くと、スレッドごとの処理の内訳を確認できます。
+   * @return {string} - trace eventのJSON
+   */
+  dump_trace(): string {
+    return this.addon.dump_trace()
+  }
+
+  /**
+   * 初期化の段階ごとにかかった時間(ミリ秒)を取得します。
+   * 段階の名前はcore_init(Coreライブラリとモデルの読み込み)、mecab_load(辞書の読み込み)、
+   * default_dict(既定の辞書のコンパイル)、user_dict(ユーザー辞書のコンパイルと読み込み直し)、total(全体)です。
+   * core_initはmecab_load、default_dict、user_dictと並行して行われます。
+   * @return {Record<string, number>} - 段階ごとの時間
+   */
+  startup_timings(): Record<string, number> {
+    return this.addon.startup_timings()
+  }
+
   /**
    * メタ情報(話者名や話者IDのリスト)を取得する関数。
    * @return {string} - メタ情報
@@ -290,10 +612,13 @@ class Engine implements IEngine {
 
   /**
    * ユーザー辞書に登録されている単語の一覧を返します。
+   * @param {string} dict_namespace - ユーザー辞書の名前空間、省略すると既定の辞書
    * @return {Record<string, UserDictWord>} - 単語のUUIDとその詳細
    */
-  get_user_dict_words(): Record<string, UserDictWord> {
-    return this.addon.get_user_dict_words()
+  get_user_dict_words(
+    dict_namespace?: string
+  ): Record<string, UserDictWord> {
+    return this.addon.get_user_dict_words(dict_namespace)
   }
 
   /**
@@ -303,6 +628,7 @@ class Engine implements IEngine {
    * @param {number} accent_type - アクセント型（音が下がる場所を指す）
    * @param {WordTypes} word_type - 単語の形式
    * @param {number} priority - 単語の優先度（0から10までの整数）、数字が大きいほど優先度が高くなる
+   * @param {string} dict_namespace - ユーザー辞書の名前空間、省略すると既定の辞書
    * @return {string} - 単語のUUID
    */
   add_user_dict_word(
@@ -310,14 +636,16 @@ class Engine implements IEngine {
     pronunciation: string,
     accent_type: number,
     word_type?: WordTypes,
-    priority?: number
+    priority?: number,
+    dict_namespace?: string
   ): string {
     return this.addon.add_user_dict_word(
       surface,
       pronunciation,
       accent_type,
       word_type,
-      priority
+      priority,
+      dict_namespace
     )
   }
 
@@ -329,6 +657,7 @@ class Engine implements IEngine {
    * @param {string} word_uuid - 更新する言葉のUUID
    * @param {WordTypes} word_type - 単語の形式
    * @param {number} priority - 単語の優先度（0から10までの整数）、数字が大きいほど優先度が高くなる
+   * @param {string} dict_namespace - ユーザー辞書の名前空間、省略すると既定の辞書
    */
   rewrite_user_dict_word(
     surface: string,
@@ -336,7 +665,8 @@ class Engine implements IEngine {
     accent_type: number,
     word_uuid: string,
     word_type?: WordTypes,
-    priority?: number
+    priority?: number,
+    dict_namespace?: string
   ): void {
     this.addon.rewrite_user_dict_word(
       surface,
@@ -344,16 +674,132 @@ class Engine implements IEngine {
       accent_type,
       word_uuid,
       word_type,
-      priority
+      priority,
+      dict_namespace
+    )
+  }
+
+  /**
+   * ユーザー辞書に登録されている言葉を削除します。
+   * @param {string} word_uuid - 削除する言葉のUUID
+   * @param {string} dict_namespace - ユーザー辞書の名前空間、省略すると既定の辞書
+   */
+  delete_user_dict_word(word_uuid: string, dict_namespace?: string): void {
+    this.addon.delete_user_dict_word(word_uuid, dict_namespace)
+  }
+
+  /**
+   * ユーザー辞書に言葉を追加します。
+   * 辞書の更新はバックグラウンドで行われ、続けて行われた変更はまとめて反映されます。
+   * @param {string} surface - 言葉の表層形
+   * @param {string} pronunciation - 言葉の発音（カタカナ）
+   * @param {number} accent_type - アクセント型（音が下がる場所を指す）
+   * @param {WordTypes} word_type - 単語の形式
+   * @param {number} priority - 単語の優先度（0から10までの整数）、数字が大きいほど優先度が高くなる
+   * @param {string} dict_namespace - ユーザー辞書の名前空間、省略すると既定の辞書
+   * @return {Promise<string>} - 新しい辞書が読み込まれた後に、単語のUUIDで解決される
+   */
+  add_user_dict_word_async(
+    surface: string,
+    pronunciation: string,
+    accent_type: number,
+    word_type?: WordTypes,
+    priority?: number,
+    dict_namespace?: string
+  ): Promise<string> {
+    return this.addon.add_user_dict_word_async(
+      surface,
+      pronunciation,
+      accent_type,
+      word_type,
+      priority,
+      dict_namespace
+    )
+  }
+
+  /**
+   * ユーザー辞書に登録されている言葉を更新します。
+   * 辞書の更新はバックグラウンドで行われ、続けて行われた変更はまとめて反映されます。
+   * @param {string} surface - 言葉の表層形
+   * @param {string} pronunciation - 言葉の発音（カタカナ）
+   * @param {number} accent_type - アクセント型（音が下がる場所を指す）
+   * @param {string} word_uuid - 更新する言葉のUUID
+   * @param {WordTypes} word_type - 単語の形式
+   * @param {number} priority - 単語の優先度（0から10までの整数）、数字が大きいほど優先度が高くなる
+   * @param {string} dict_namespace - ユーザー辞書の名前空間、省略すると既定の辞書
+   * @return {Promise<void>} - 新しい辞書が読み込まれた後に解決される
+   */
+  rewrite_user_dict_word_async(
+    surface: string,
+    pronunciation: string,
+    accent_type: number,
+    word_uuid: string,
+    word_type?: WordTypes,
+    priority?: number,
+    dict_namespace?: string
+  ): Promise<void> {
+    return this.addon.rewrite_user_dict_word_async(
+      surface,
+      pronunciation,
+      accent_type,
+      word_uuid,
+      word_type,
+      priority,
+      dict_namespace
     )
   }
 
   /**
    * ユーザー辞書に登録されている言葉を削除します。
+   * 辞書の更新はバックグラウンドで行われ、続けて行われた変更はまとめて反映されます。
    * @param {string} word_uuid - 削除する言葉のUUID
+   * @param {string} dict_namespace - ユーザー辞書の名前空間、省略すると既定の辞書
+   * @return {Promise<void>} - 新しい辞書が読み込まれた後に解決される
+   */
+  delete_user_dict_word_async(
+    word_uuid: string,
+    dict_namespace?: string
+  ): Promise<void> {
+    return this.addon.delete_user_dict_word_async(word_uuid, dict_namespace)
+  }
+
+  /**
+   * ユーザー辞書の名前空間を作成します。
+   * 名前空間ごとに独立したユーザー辞書を持ち、音声合成のモデルと、起動時にコンパイルした既定の辞書は共有されます。
+   * MeCabのシステム辞書は名前空間ごとに読み込み、コンパイルするのはその名前空間の単語のみです。
+   * 読み込みとコンパイルはこのスレッドで行うため、サーバーではcreate_dict_namespace_asyncを使ってください。
+   * 既に存在する場合は何もしません。
+   * @param {string} name - 名前空間の名前（英数字と-_のみ、64文字まで）
+   */
+  create_dict_namespace(name: string): void {
+    this.addon.create_dict_namespace(name)
+  }
+
+  /**
+   * create_dict_namespaceと同じく名前空間を作成しますが、辞書の読み込みとコンパイルを別のスレッドで行います。
+   * 作成中の名前空間を、同期・非同期を問わずもう一度作成しようとするとエラーになります。
+   * @param {string} name - 名前空間の名前（英数字と-_のみ、64文字まで）
+   * @return {Promise<void>} - 名前空間が使えるようになった後に解決される
+   */
+  create_dict_namespace_async(name: string): Promise<void> {
+    return this.addon.create_dict_namespace_async(name)
+  }
+
+  /**
+   * ユーザー辞書の名前空間を削除します。
+   * 辞書ファイルは削除されず、同じ名前で作成し直すと再び読み込まれます。
+   * @param {string} name - 名前空間の名前
+   */
+  delete_dict_namespace(name: string): void {
+    this.addon.delete_dict_namespace(name)
+  }
+
+  /**
+   * 作成されているユーザー辞書の名前空間の一覧を返します。
+   * @return {string[]} - 名前空間の名前
    */
-  delete_user_dict_word(word_uuid: string): void {
-    this.addon.delete_user_dict_word(word_uuid)
+  dict_namespaces(): string[] {
+    return this.addon.dict_namespaces()
   }
 }
 